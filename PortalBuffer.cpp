@@ -0,0 +1,127 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+#include "PortalBuffer.h"
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+static const char HEX_DIGITS_LOWER[] = "0123456789abcdef";
+
+PortalBuffer::PortalBuffer(char* buffer, size_t capacity) {
+  _buffer = buffer;
+  _capacity = capacity;
+  clear();
+}
+
+PortalBuffer::PortalBuffer(char* buffer, size_t capacity, size_t length) {
+  _buffer = buffer;
+  _capacity = capacity;
+  // Keep the first `length` characters: clear() would zero buffer[0]
+  _length = 0;
+  _overflow = false;
+  truncate(length);
+}
+
+void PortalBuffer::truncate(size_t len) {
+  if (len < _capacity) {
+    _length = len;
+    _buffer[_length] = '\0';
+  }
+}
+
+void PortalBuffer::clear() {
+  _length = 0;
+  _overflow = false;
+  if (_capacity > 0) {
+    _buffer[0] = '\0';
+  }
+}
+
+PortalBuffer& PortalBuffer::append(const char* text) {
+  return append(text, strlen(text));
+}
+
+PortalBuffer& PortalBuffer::append(const char* text, size_t len) {
+  // Keep one byte for the terminator
+  if (_length + len >= _capacity) {
+    _overflow = true;
+    return *this;
+  }
+  memcpy(_buffer + _length, text, len);
+  _length += len;
+  _buffer[_length] = '\0';
+  return *this;
+}
+
+PortalBuffer& PortalBuffer::append(char c) {
+  return append(&c, 1);
+}
+
+PortalBuffer& PortalBuffer::appendP(const char* text) {
+  size_t len = strlen_P(text);
+  if (_length + len >= _capacity) {
+    _overflow = true;
+    return *this;
+  }
+  memcpy_P(_buffer + _length, text, len);
+  _length += len;
+  _buffer[_length] = '\0';
+  return *this;
+}
+
+PortalBuffer& PortalBuffer::appendEncoded(const char* text) {
+  for (const char* p = text; *p != '\0'; p++) {
+    char c = *p;
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+        c == '-' || c == '.' || c == '_' || c == '~') {
+      append(c);
+    } else {
+      char escaped[3] = { '%', HEX_DIGITS[(uint8_t)c >> 4], HEX_DIGITS[(uint8_t)c & 0x0F] };
+      append(escaped, 3);
+    }
+  }
+  return *this;
+}
+
+PortalBuffer& PortalBuffer::appendMac(const uint8_t* mac) {
+  for (int i = 0; i < 6; i++) {
+    if (i > 0) {
+      append("%3A", 3);
+    }
+    char octet[2] = { HEX_DIGITS_LOWER[mac[i] >> 4], HEX_DIGITS_LOWER[mac[i] & 0x0F] };
+    append(octet, 2);
+  }
+  return *this;
+}
+
+PortalBuffer& PortalBuffer::appendIP(const IPAddress& ip) {
+  for (int i = 0; i < 4; i++) {
+    if (i > 0) {
+      append('.');
+    }
+    appendNumber(ip[i]);
+  }
+  return *this;
+}
+
+PortalBuffer& PortalBuffer::appendNumber(unsigned long value) {
+  char digits[20];
+  size_t count = 0;
+  do {
+    digits[count++] = '0' + (value % 10);
+    value /= 10;
+  } while (value > 0);
+  while (count > 0) {
+    append(digits[--count]);
+  }
+  return *this;
+}
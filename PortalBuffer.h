@@ -0,0 +1,69 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+
+#ifndef PortalBuffer_h
+#define PortalBuffer_h
+
+#include "Arduino.h"
+#include <IPAddress.h>
+
+// Fixed-capacity text builder over a caller-owned buffer. Used for the
+// login request so nothing on the login path touches the heap. Appends
+// past the capacity are dropped and flagged via overflowed().
+class PortalBuffer {
+  public:
+    PortalBuffer(char* buffer, size_t capacity);
+
+    // Continue an existing string of the given length
+    PortalBuffer(char* buffer, size_t capacity, size_t length);
+
+    // Reset to an empty string
+    void clear();
+
+    // Drop everything after the first len characters
+    void truncate(size_t len);
+
+    // Append raw text
+    PortalBuffer& append(const char* text);
+    PortalBuffer& append(const char* text, size_t len);
+    PortalBuffer& append(char c);
+
+    // Append text stored in flash (PROGMEM)
+    PortalBuffer& appendP(const char* text);
+
+    // Append text percent-encoded for application/x-www-form-urlencoded
+    PortalBuffer& appendEncoded(const char* text);
+
+    // Append a MAC address as lowercase hex with ':' encoded as %3A
+    PortalBuffer& appendMac(const uint8_t* mac);
+
+    // Append an IPv4 address in dotted-decimal form
+    PortalBuffer& appendIP(const IPAddress& ip);
+
+    // Append an unsigned decimal number
+    PortalBuffer& appendNumber(unsigned long value);
+
+    size_t capacity() const { return _capacity; }
+    const char* c_str() const { return _buffer; }
+    size_t length() const { return _length; }
+    bool overflowed() const { return _overflow; }
+
+  private:
+    char* _buffer;
+    size_t _capacity;
+    size_t _length;
+    bool _overflow;
+};
+
+#endif
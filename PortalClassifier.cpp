@@ -0,0 +1,98 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+#include "PortalClassifier.h"
+
+// Lowercase markers seen in SmartZone hotspotlogin responses: the WISPr
+// reply embedded in the result page, the controller's result phrases and
+// its redirect reasons. Whole phrases only: single words like "welcome"
+// or "incorrect" also appear on the portal's own login page.
+static const char M_WISPR_OK[] PROGMEM = "<responsecode>50</responsecode>";
+static const char M_LOGGED_IN[] PROGMEM = "you are now logged in";
+static const char M_LOGIN_OK[] PROGMEM = "login succeeded";
+static const char M_ALREADY[] PROGMEM = "already logged in";
+static const char M_ALREADY_AUTH[] PROGMEM = "already authorized";
+static const char M_QUOTA[] PROGMEM = "quota exceeded";
+static const char M_MAX_DEVICES[] PROGMEM = "maximum number of devices";
+static const char M_WISPR_REJECT[] PROGMEM = "<responsecode>100</responsecode>";
+static const char M_ACCESS_REJECT[] PROGMEM = "access-reject";
+static const char M_INVALID[] PROGMEM = "invalid user";
+static const char M_AUTH_FAILED[] PROGMEM = "authentication failed";
+static const char M_AUTH_FAIL[] PROGMEM = "reason=auth_fail";
+static const char M_LOGIN_FAILED[] PROGMEM = "login failed";
+
+struct Marker {
+  const char* text;
+  PortalClassifier::Verdict verdict;
+};
+
+static const Marker MARKERS[] PROGMEM = {
+  { M_WISPR_OK,      PortalClassifier::VERDICT_SUCCESS },
+  { M_LOGGED_IN,     PortalClassifier::VERDICT_SUCCESS },
+  { M_LOGIN_OK,      PortalClassifier::VERDICT_SUCCESS },
+  { M_ALREADY,       PortalClassifier::VERDICT_ALREADY_LOGGED_IN },
+  { M_ALREADY_AUTH,  PortalClassifier::VERDICT_ALREADY_LOGGED_IN },
+  { M_QUOTA,         PortalClassifier::VERDICT_QUOTA_EXCEEDED },
+  { M_MAX_DEVICES,   PortalClassifier::VERDICT_QUOTA_EXCEEDED },
+  { M_WISPR_REJECT,  PortalClassifier::VERDICT_BAD_CREDENTIALS },
+  { M_ACCESS_REJECT, PortalClassifier::VERDICT_BAD_CREDENTIALS },
+  { M_INVALID,       PortalClassifier::VERDICT_BAD_CREDENTIALS },
+  { M_AUTH_FAILED,   PortalClassifier::VERDICT_BAD_CREDENTIALS },
+  { M_AUTH_FAIL,     PortalClassifier::VERDICT_BAD_CREDENTIALS },
+  { M_LOGIN_FAILED,  PortalClassifier::VERDICT_BAD_CREDENTIALS }
+};
+static const uint8_t MARKER_COUNT = sizeof(MARKERS) / sizeof(MARKERS[0]);
+
+PortalClassifier::PortalClassifier() {
+  reset();
+}
+
+void PortalClassifier::reset() {
+  memset(_progress, 0, sizeof(_progress));
+  _verdict = VERDICT_NONE;
+}
+
+void PortalClassifier::feed(char c) {
+  if (c >= 'A' && c <= 'Z') {
+    c += 'a' - 'A';
+  } else if (c == '+') {
+    c = ' '; // form-encoded space in redirect queries
+  }
+
+  for (uint8_t i = 0; i < MARKER_COUNT && i < MAX_MARKERS; i++) {
+    const char* text = (const char*)pgm_read_ptr(&MARKERS[i].text);
+    uint8_t matched = _progress[i];
+    if ((char)pgm_read_byte(text + matched) == c) {
+      matched++;
+    } else {
+      // Restart on the first letter; only a match overlapping a partial one
+      // of the same marker can be missed, which real pages don't produce
+      matched = ((char)pgm_read_byte(text) == c) ? 1 : 0;
+    }
+
+    if (pgm_read_byte(text + matched) == '\0') {
+      Verdict verdict = (Verdict)pgm_read_byte(&MARKERS[i].verdict);
+      if (verdict > _verdict) {
+        _verdict = verdict;
+      }
+      matched = 0;
+    }
+    _progress[i] = matched;
+  }
+}
+
+void PortalClassifier::feed(const char* text, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    feed(text[i]);
+  }
+}
@@ -0,0 +1,55 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+
+#ifndef PortalClassifier_h
+#define PortalClassifier_h
+
+#include "Arduino.h"
+
+// Incremental, case-insensitive scan of the login response (Location
+// header and body) for the portal's success and failure markers. Input
+// is fed as it arrives off the socket; state is one byte per marker.
+class PortalClassifier {
+  public:
+    // Marker categories, in increasing priority
+    enum Verdict : uint8_t {
+      VERDICT_NONE,
+      VERDICT_SUCCESS,
+      VERDICT_ALREADY_LOGGED_IN,
+      VERDICT_QUOTA_EXCEEDED,
+      VERDICT_BAD_CREDENTIALS
+    };
+
+    PortalClassifier();
+
+    // Start a new response
+    void reset();
+
+    // Scan more response text
+    void feed(char c);
+    void feed(const char* text, size_t len);
+
+    // Strongest marker seen so far
+    Verdict verdict() const { return _verdict; }
+
+    // True once nothing more can change the verdict
+    bool decided() const { return _verdict == VERDICT_BAD_CREDENTIALS; }
+
+  private:
+    static const uint8_t MAX_MARKERS = 16;
+    uint8_t _progress[MAX_MARKERS];
+    Verdict _verdict;
+};
+
+#endif
@@ -0,0 +1,50 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+#include "PortalHistogram.h"
+
+// Roughly logarithmic: LAN round trips at the bottom, HTTP timeouts at the top
+static const uint16_t BUCKET_BOUNDS_MS[PortalHistogram::BUCKETS - 1] PROGMEM = {
+  10, 25, 50, 100, 250, 500, 1000, 2500, 5000
+};
+
+PortalHistogram::PortalHistogram() {
+  reset();
+}
+
+void PortalHistogram::reset() {
+  memset(_buckets, 0, sizeof(_buckets));
+  _count = 0;
+  _totalMs = 0;
+  _maxMs = 0;
+}
+
+unsigned long PortalHistogram::upperBound(uint8_t i) {
+  if (i >= BUCKETS - 1) {
+    return 0;
+  }
+  return pgm_read_word(&BUCKET_BOUNDS_MS[i]);
+}
+
+void PortalHistogram::record(unsigned long ms) {
+  uint8_t i = 0;
+  while (i < BUCKETS - 1 && ms > pgm_read_word(&BUCKET_BOUNDS_MS[i])) {
+    i++;
+  }
+  _buckets[i]++;
+  _count++;
+  _totalMs += ms;
+  if (ms > _maxMs) {
+    _maxMs = ms;
+  }
+}
@@ -0,0 +1,48 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+
+#ifndef PortalHistogram_h
+#define PortalHistogram_h
+
+#include "Arduino.h"
+
+// Fixed-bucket latency histogram: one counter per bucket, no allocation,
+// cheap enough to update on every network step.
+class PortalHistogram {
+  public:
+    // Upper bounds 10, 25, 50, 100, 250, 500, 1000, 2500, 5000 ms, and a
+    // last bucket for everything slower
+    static const uint8_t BUCKETS = 10;
+
+    PortalHistogram();
+
+    void record(unsigned long ms);
+    void reset();
+
+    // Inclusive upper bound of bucket i in ms (0 for the last bucket)
+    static unsigned long upperBound(uint8_t i);
+
+    uint32_t bucket(uint8_t i) const { return (i < BUCKETS) ? _buckets[i] : 0; }
+    uint32_t count() const { return _count; }
+    unsigned long maxMs() const { return _maxMs; }
+    unsigned long meanMs() const { return _count ? _totalMs / _count : 0; }
+
+  private:
+    uint32_t _buckets[BUCKETS];
+    uint32_t _count;
+    unsigned long _totalMs;
+    unsigned long _maxMs;
+};
+
+#endif
@@ -0,0 +1,363 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+#include "PortalProbeSet.h"
+#include "PortalBuffer.h"
+
+#if defined(ESP32)
+  #include <WiFi.h>
+  #include <lwip/sockets.h>
+#elif defined(ESP8266)
+  #include <ESP8266WiFi.h>
+#else
+  #include <WiFi.h>
+#endif
+
+// Response scan phases
+static const uint8_t PHASE_STATUS = 0;
+static const uint8_t PHASE_NAME = 1;
+static const uint8_t PHASE_VALUE = 2;
+static const uint8_t PHASE_LOCATION = 3;
+
+PortalProbeSet::PortalProbeSet() {
+  _count = 0;
+  _timeoutMs = 0;
+  _quorum = 1;
+  _successes = 0;
+  _failures = 0;
+  _intercepted = false;
+  _redirect = NULL;
+  _redirectOwner = NULL;
+}
+
+bool PortalProbeSet::add(const char* host, const char* path, uint16_t expectedStatus) {
+  if (_count >= MAX_TARGETS || host == NULL || path == NULL) {
+    return false;
+  }
+  Target& target = _targets[_count++];
+  target.host = host;
+  target.path = path;
+  target.expectedStatus = expectedStatus;
+  target.latencyMs = 0;
+  target.address = IPAddress();
+  return true;
+}
+
+void PortalProbeSet::setAddress(uint8_t index, const IPAddress& address) {
+  if (index < _count) {
+    _targets[index].address = address;
+  }
+}
+
+void PortalProbeSet::clear() {
+  _count = 0;
+}
+
+const char* PortalProbeSet::host(uint8_t index) const {
+  return (index < _count) ? _targets[index].host : NULL;
+}
+
+unsigned long PortalProbeSet::latency(uint8_t index) const {
+  return (index < _count) ? _targets[index].latencyMs : 0;
+}
+
+bool PortalProbeSet::run(uint16_t timeoutMs, uint8_t quorum, PortalRedirect& redirect) {
+  if (_count == 0) {
+    return false;
+  }
+  _timeoutMs = timeoutMs;
+  _quorum = (quorum == 0) ? 1 : (quorum > _count ? _count : quorum);
+  _successes = 0;
+  _failures = 0;
+  _intercepted = false;
+  _redirect = &redirect;
+  _redirectOwner = NULL;
+
+  uint8_t order[MAX_TARGETS];
+  _order(order);
+  unsigned long deadline = millis() + timeoutMs;
+  #if defined(ESP32)
+    return _runConcurrent(order, deadline);
+  #else
+    return _runSequential(order, deadline);
+  #endif
+}
+
+void PortalProbeSet::_order(uint8_t* order) const {
+  // Fastest first; targets never probed (0) go first to get measured
+  for (uint8_t i = 0; i < _count; i++) {
+    uint8_t j = i;
+    while (j > 0 && _targets[order[j - 1]].latencyMs > _targets[i].latencyMs) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = i;
+  }
+}
+
+void PortalProbeSet::_start(Target& target) {
+  target.response.status = -1;
+  target.response.phase = PHASE_STATUS;
+  target.response.length = 0;
+  target.response.leading = true;
+  target.startedAt = millis();
+  target.finished = false;
+}
+
+bool PortalProbeSet::_feed(Target& target, char c) {
+  Response& response = target.response;
+  switch (response.phase) {
+    case PHASE_STATUS:
+      if (c != '\n') {
+        if (response.length < sizeof(response.text) - 1) {
+          response.text[response.length++] = c;
+        }
+        return false;
+      }
+      response.text[response.length] = '\0';
+      // "HTTP/1.0 204 No Content"; anything else is a portal or a proxy
+      response.status = (response.length >= 12 && strncmp(response.text, "HTTP/1.", 7) == 0) ? atoi(response.text + 9) : 0;
+      if (response.status < 300 || response.status >= 400 || _redirectOwner != NULL) {
+        return true;
+      }
+      // First redirect seen: read on for its Location
+      _redirectOwner = &target;
+      response.phase = PHASE_NAME;
+      response.length = 0;
+      return false;
+
+    case PHASE_NAME:
+      if (c == '\n') {
+        return true; // end of headers without a Location
+      }
+      if (c == ':') {
+        response.text[response.length] = '\0';
+        response.phase = (strcasecmp(response.text, "Location") == 0) ? PHASE_LOCATION : PHASE_VALUE;
+        response.leading = true;
+      } else if (response.length < sizeof(response.text) - 1) {
+        response.text[response.length++] = c;
+      }
+      return false;
+
+    case PHASE_VALUE:
+      if (c == '\n') {
+        response.phase = PHASE_NAME;
+        response.length = 0;
+      }
+      return false;
+
+    default: // PHASE_LOCATION
+      if (c == '\n') {
+        _redirect->finish();
+        return true;
+      }
+      if (c != '\r' && !(response.leading && c == ' ')) {
+        response.leading = false;
+        _redirect->feed(c);
+      }
+      return false;
+  }
+}
+
+void PortalProbeSet::_finish(Target& target, bool answered) {
+  target.finished = true;
+  bool expected = answered && target.response.status == target.expectedStatus;
+
+  // Smoothed over runs; a miss costs the whole timeout so the order
+  // moves away from targets that are filtered or slow on this network
+  unsigned long elapsed = _timeoutMs;
+  if (expected) {
+    elapsed = millis() - target.startedAt;
+    if (elapsed == 0) {
+      elapsed = 1; // 0 means never probed
+    }
+  }
+  target.latencyMs = (target.latencyMs == 0) ? elapsed : (3 * target.latencyMs + elapsed) / 4;
+
+  if (expected) {
+    _successes++;
+  } else {
+    _failures++;
+    if (answered && target.response.status > 0) {
+      _intercepted = true;
+    }
+    Serial.printf("[PortalLib] Probe of %s failed, HTTP code: %d.\n", target.host, target.response.status);
+  }
+}
+
+bool PortalProbeSet::_decided() const {
+  if (_successes >= _quorum) {
+    return true;
+  }
+  // Out of reach; still let the redirect owner finish its Location
+  if (_count - _failures < _quorum) {
+    return _redirectOwner == NULL || _redirectOwner->finished;
+  }
+  return false;
+}
+
+size_t PortalProbeSet::_request(const Target& target, char* buffer, size_t capacity) const {
+  PortalBuffer request(buffer, capacity);
+  request.append("GET ").append(target.path).append(" HTTP/1.0\r\nHost: ");
+  request.append(target.host).append("\r\n\r\n");
+  return request.overflowed() ? 0 : request.length();
+}
+
+#if defined(ESP32)
+
+bool PortalProbeSet::_runConcurrent(const uint8_t* order, unsigned long deadline) {
+  // Open every connection up front, to the addresses handed in
+  for (uint8_t i = 0; i < _count; i++) {
+    Target& target = _targets[order[i]];
+    _start(target);
+    target.socket = -1;
+    target.sent = false;
+    if ((long)(deadline - millis()) <= 0 || (uint32_t)target.address == 0) {
+      _finish(target, false);
+      continue;
+    }
+    target.socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (target.socket < 0) {
+      _finish(target, false);
+      continue;
+    }
+    fcntl(target.socket, F_SETFL, fcntl(target.socket, F_GETFL, 0) | O_NONBLOCK);
+
+    struct sockaddr_in server;
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_port = htons(80);
+    server.sin_addr.s_addr = (uint32_t)target.address;
+    if (connect(target.socket, (struct sockaddr*)&server, sizeof(server)) < 0 && errno != EINPROGRESS) {
+      _close(target);
+      _finish(target, false);
+    }
+  }
+
+  char request[128];
+  while (!_decided() && (long)(deadline - millis()) > 0) {
+    fd_set readable;
+    fd_set writable;
+    FD_ZERO(&readable);
+    FD_ZERO(&writable);
+    int maxSocket = -1;
+    for (uint8_t i = 0; i < _count; i++) {
+      Target& target = _targets[i];
+      if (!target.finished) {
+        FD_SET(target.socket, target.sent ? &readable : &writable);
+        if (target.socket > maxSocket) {
+          maxSocket = target.socket;
+        }
+      }
+    }
+    if (maxSocket < 0) {
+      break;
+    }
+
+    unsigned long remaining = deadline - millis();
+    struct timeval wait;
+    wait.tv_sec = remaining / 1000;
+    wait.tv_usec = (remaining % 1000) * 1000;
+    if (select(maxSocket + 1, &readable, &writable, NULL, &wait) <= 0) {
+      break;
+    }
+
+    for (uint8_t i = 0; i < _count; i++) {
+      Target& target = _targets[i];
+      if (target.finished) {
+        continue;
+      }
+      if (!target.sent && FD_ISSET(target.socket, &writable)) {
+        // Connected (or refused): send the request in one go
+        int error = 0;
+        socklen_t errorLength = sizeof(error);
+        getsockopt(target.socket, SOL_SOCKET, SO_ERROR, &error, &errorLength);
+        size_t length = _request(target, request, sizeof(request));
+        if (error != 0 || length == 0 || send(target.socket, request, length, 0) != (int)length) {
+          _close(target);
+          _finish(target, false);
+        } else {
+          target.sent = true;
+        }
+      } else if (target.sent && FD_ISSET(target.socket, &readable)) {
+        char chunk[64];
+        int received = recv(target.socket, chunk, sizeof(chunk), 0);
+        bool done = (received <= 0);
+        for (int k = 0; k < received && !done; k++) {
+          done = _feed(target, chunk[k]);
+        }
+        if (done) {
+          _close(target);
+          _finish(target, target.response.status >= 0);
+        }
+      }
+    }
+  }
+
+  // Targets left over once the answer is known are dropped as they are;
+  // only a real timeout counts against them
+  bool timedOut = !_decided();
+  for (uint8_t i = 0; i < _count; i++) {
+    Target& target = _targets[i];
+    if (!target.finished) {
+      _close(target);
+      if (timedOut) {
+        _finish(target, false);
+      }
+    }
+  }
+  return _successes >= _quorum;
+}
+
+void PortalProbeSet::_close(Target& target) {
+  if (target.socket >= 0) {
+    close(target.socket);
+    target.socket = -1;
+  }
+}
+
+#else
+
+bool PortalProbeSet::_runSequential(const uint8_t* order, unsigned long deadline) {
+  WiFiClient client;
+  char request[128];
+  for (uint8_t i = 0; i < _count && !_decided(); i++) {
+    Target& target = _targets[order[i]];
+    _start(target);
+    long remaining = (long)(deadline - millis());
+    if (remaining <= 0 || (uint32_t)target.address == 0) {
+      _finish(target, false);
+      continue;
+    }
+
+    client.setTimeout(remaining);
+    size_t length = _request(target, request, sizeof(request));
+    if (length == 0 || !client.connect(target.address, 80)) {
+      client.stop();
+      _finish(target, false);
+      continue;
+    }
+    client.write((const uint8_t*)request, length);
+
+    char c;
+    bool done = false;
+    while (!done && client.readBytes(&c, 1) == 1) {
+      done = _feed(target, c);
+    }
+    client.stop();
+    _finish(target, target.response.status >= 0);
+  }
+  return _successes >= _quorum;
+}
+
+#endif
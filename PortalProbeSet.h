@@ -0,0 +1,114 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+#ifndef PortalProbeSet_h
+#define PortalProbeSet_h
+
+#include "Arduino.h"
+#include "PortalRedirect.h"
+
+// A set of HTTP connectivity endpoints probed together (PROBE_MULTI), so
+// one slow or filtered endpoint no longer reads as a logged-out session.
+// On ESP32 all targets are in flight at once over non-blocking lwIP
+// sockets; elsewhere they are tried one by one, fastest first. Nothing is
+// looked up here: the caller hands in the addresses. Each target
+// keeps a smoothed answer time that decides the order of the next run.
+class PortalProbeSet {
+  public:
+    static const uint8_t MAX_TARGETS = 4;
+
+    PortalProbeSet();
+
+    // Add a target answering expectedStatus once the internet is reachable.
+    // host and path are not copied: pass string literals.
+    bool add(const char* host, const char* path, uint16_t expectedStatus);
+    void clear();
+
+    // Address each target (in the order added) connects to in the next
+    // run; the caller resolves them through its DNS cache. 0.0.0.0 (the
+    // default) leaves the target out of the run as a failure.
+    void setAddress(uint8_t index, const IPAddress& address);
+
+    // Probe the targets until `quorum` of them gave their expected answer
+    // (true) or too few are left to reach it (false). A portal redirect
+    // from any target is fed into redirect.
+    bool run(uint16_t timeoutMs, uint8_t quorum, PortalRedirect& redirect);
+
+    // Some target got an HTTP answer other than its expected one in the
+    // last run: a portal or proxy is intercepting, even without a redirect
+    bool intercepted() const { return _intercepted; }
+
+    uint8_t count() const { return _count; }
+    const char* host(uint8_t index) const;
+
+    // Smoothed answer time of a target (ms, 0 = not probed yet); timeouts
+    // and wrong answers count as the full timeout
+    unsigned long latency(uint8_t index) const;
+
+  private:
+    // Incremental scan of one response head: the status code, then the
+    // Location header when this target owns the redirect
+    struct Response {
+      int status;       // -1 until the status line is complete
+      uint8_t phase;
+      char text[16];    // status line start or header name
+      uint8_t length;
+      bool leading;
+    };
+
+    struct Target {
+      const char* host;
+      const char* path;
+      uint16_t expectedStatus;
+      unsigned long latencyMs;
+      IPAddress address;
+
+      // Per-run state
+      Response response;
+      unsigned long startedAt;
+      bool finished;
+      #if defined(ESP32)
+        int socket;
+        bool sent;
+      #endif
+    };
+
+    void _order(uint8_t* order) const;
+    void _start(Target& target);
+    // Returns true once the response head needs no more characters
+    bool _feed(Target& target, char c);
+    void _finish(Target& target, bool answered);
+    bool _decided() const;
+    size_t _request(const Target& target, char* buffer, size_t capacity) const;
+
+    #if defined(ESP32)
+      bool _runConcurrent(const uint8_t* order, unsigned long deadline);
+      void _close(Target& target);
+    #else
+      bool _runSequential(const uint8_t* order, unsigned long deadline);
+    #endif
+
+    Target _targets[MAX_TARGETS];
+    uint8_t _count;
+
+    // Per-run state
+    uint16_t _timeoutMs;
+    uint8_t _quorum;
+    uint8_t _successes;
+    uint8_t _failures;
+    bool _intercepted;
+    PortalRedirect* _redirect;
+    Target* _redirectOwner;
+};
+
+#endif
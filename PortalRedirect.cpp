@@ -0,0 +1,141 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+#include "PortalRedirect.h"
+
+PortalRedirect::PortalRedirect() {
+  clear();
+}
+
+void PortalRedirect::clear() {
+  _inQuery = false;
+  _inValue = false;
+  _overflow = false;
+  _keyLength = 0;
+  _valueLength = 0;
+  _hasApMac = false;
+  _hasClientIP = false;
+  _hasSip = false;
+  _sip[0] = '\0';
+  _dn[0] = '\0';
+  _url[0] = '\0';
+}
+
+void PortalRedirect::feed(char c) {
+  if (!_inQuery) {
+    _inQuery = (c == '?');
+    return;
+  }
+  if (c == '&' || c == '#') {
+    _endValue();
+    _inQuery = (c == '&');
+    return;
+  }
+  if (!_inValue) {
+    if (c == '=') {
+      _inValue = true;
+    } else if (_keyLength < sizeof(_key) - 1) {
+      _key[_keyLength++] = c;
+    } else {
+      _overflow = true;
+    }
+    return;
+  }
+  if (_valueLength < sizeof(_value) - 1) {
+    _value[_valueLength++] = c;
+  } else {
+    _overflow = true;
+  }
+}
+
+void PortalRedirect::finish() {
+  if (_inQuery) {
+    _endValue();
+  }
+  _inQuery = false;
+}
+
+void PortalRedirect::parse(const char* location) {
+  while (*location != '\0') {
+    feed(*location++);
+  }
+  finish();
+}
+
+void PortalRedirect::_endValue() {
+  _key[_keyLength] = '\0';
+  _value[_valueLength] = '\0';
+
+  // Truncated keys or values are dropped rather than sent half-written
+  if (_inValue && !_overflow) {
+    if (strcmp(_key, "mac") == 0) {
+      _hasApMac = _parseMac(_value, _apMac);
+    } else if (strcmp(_key, "uip") == 0) {
+      _hasClientIP = _parseIP(_value, _clientIP);
+    } else if (strcmp(_key, "sip") == 0 && _valueLength < sizeof(_sip)) {
+      memcpy(_sip, _value, _valueLength + 1);
+      _hasSip = (_valueLength > 0);
+    } else if (strcmp(_key, "dn") == 0 && _valueLength < sizeof(_dn)) {
+      memcpy(_dn, _value, _valueLength + 1);
+    } else if (strcmp(_key, "url") == 0 && _valueLength < sizeof(_url)) {
+      memcpy(_url, _value, _valueLength + 1);
+    }
+  }
+
+  _inValue = false;
+  _overflow = false;
+  _keyLength = 0;
+  _valueLength = 0;
+}
+
+bool PortalRedirect::_parseMac(const char* text, uint8_t* mac) {
+  // Accepts "aa:bb:..", "aa-bb-..", "aa%3Abb%3A.." and "aabbcc.."
+  int digits = 0;
+  for (const char* p = text; *p != '\0' && digits < 12; p++) {
+    if (*p == '%' && p[1] != '\0' && p[2] != '\0') {
+      p += 2; // encoded separator
+      continue;
+    }
+    char c = *p;
+    uint8_t nibble;
+    if (c >= '0' && c <= '9') nibble = c - '0';
+    else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+    else continue;
+    if (digits % 2 == 0) {
+      mac[digits / 2] = nibble << 4;
+    } else {
+      mac[digits / 2] |= nibble;
+    }
+    digits++;
+  }
+  return digits == 12;
+}
+
+bool PortalRedirect::_parseIP(const char* text, uint8_t* ip) {
+  int octet = 0;
+  int value = -1;
+  for (const char* p = text; ; p++) {
+    if (*p >= '0' && *p <= '9') {
+      value = (value < 0 ? 0 : value * 10) + (*p - '0');
+      if (value > 255) return false;
+    } else if ((*p == '.' || *p == '\0') && value >= 0 && octet < 4) {
+      ip[octet++] = value;
+      value = -1;
+      if (*p == '\0') break;
+    } else {
+      return false;
+    }
+  }
+  return octet == 4;
+}
@@ -0,0 +1,76 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+
+#ifndef PortalRedirect_h
+#define PortalRedirect_h
+
+#include "Arduino.h"
+#include <IPAddress.h>
+
+// Streaming parser for the captive-portal redirect (Location header) the
+// SmartZone controller sends in reply to the connectivity probe, e.g.
+//   https://wifi.utm.my/?sip=...&mac=..&client_mac=..&uip=..&dn=..&url=..
+// Characters are fed one at a time into fixed buffers; nothing is
+// allocated. Values are kept percent-encoded, ready for the login form.
+class PortalRedirect {
+  public:
+    PortalRedirect();
+
+    // Forget everything parsed so far
+    void clear();
+
+    // Feed the Location value one character at a time, then call finish()
+    void feed(char c);
+    void finish();
+
+    // Parse a complete Location value
+    void parse(const char* location);
+
+    // True once a redirect carrying the portal parameters was parsed
+    bool valid() const { return _hasSip; }
+
+    bool hasApMac() const { return _hasApMac; }
+    const uint8_t* apMac() const { return _apMac; }
+    bool hasClientIP() const { return _hasClientIP; }
+    IPAddress clientIP() const { return IPAddress(_clientIP[0], _clientIP[1], _clientIP[2], _clientIP[3]); }
+    const char* sip() const { return _sip; }
+    const char* dn() const { return _dn; }
+    const char* url() const { return _url; }
+
+  private:
+    void _endValue();
+    static bool _parseMac(const char* text, uint8_t* mac);
+    static bool _parseIP(const char* text, uint8_t* ip);
+
+    // Scanner state
+    bool _inQuery;
+    bool _inValue;
+    bool _overflow;
+    char _key[16];
+    uint8_t _keyLength;
+    char _value[128];
+    uint8_t _valueLength;
+
+    // Parsed fields
+    bool _hasApMac;
+    uint8_t _apMac[6];
+    bool _hasClientIP;
+    uint8_t _clientIP[4];
+    bool _hasSip;
+    char _sip[64];
+    char _dn[64];
+    char _url[128];
+};
+
+#endif
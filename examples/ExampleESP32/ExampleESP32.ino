@@ -35,21 +35,14 @@ void setup() {
   // --- Set custom check interval (e.g., 2 minutes = 120000 ms) ---
   portal.setCheckInterval(120000);
 
-  // --- Perform initial login ---
-  Serial.println("Performing initial portal login...");
-  if (portal.attemptLogin()) {
-    Serial.println("Initial login attempt successful (check internet next).");
-  } else {
-    Serial.println("Initial login attempt failed.");
-  }
-
-  // --- Wait a bit and check connection ---
-  delay(2000);
-  if (portal.checkInternet()) {
-     Serial.println("Setup complete: Internet OK.");
+  // --- Get online: probe first, log in only if the portal redirects us ---
+  if (portal.begin()) {
+     Serial.print("Setup complete: Internet OK, ");
+     Serial.print(portal.getOnlineTiming().bootMs);
+     Serial.println(" ms after boot.");
      // You could send a Telegram message here if needed
   } else {
-     Serial.println("Setup complete: Internet check FAILED after login.");
+     Serial.println("Setup complete: not online yet, keepConnected() will retry.");
      // You could send a Telegram message here if needed
   }
   Serial.println("Main loop starting...");
@@ -0,0 +1,93 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+#include <benchmark/benchmark.h>
+#include "ArduinoUTMWiFiPortal.h"
+#include "HostShim.h"
+#include "LoopbackPortal.h"
+#include "PortalBuffer.h"
+
+// Report operator new calls per iteration as the "allocs" counter
+static void countAllocations(benchmark::State& state, uint32_t before) {
+  state.counters["allocs"] = benchmark::Counter(HostShim::allocations() - before,
+                                                benchmark::Counter::kAvgIterations);
+}
+
+// keepConnected() while nothing is due: the cost paid on every loop()
+static void BM_KeepConnectedIdle(benchmark::State& state) {
+  LoopbackPortal server;
+  server.start();
+  server.setAuthorized(true);
+  HostShim::setStationConnected(true);
+
+  ArduinoUTMWiFiPortal portal("user", "secret");
+  uint32_t before = HostShim::allocations();
+  for (auto _ : state) {
+    portal.keepConnected();
+  }
+  countAllocations(state, before);
+  server.stop();
+}
+BENCHMARK(BM_KeepConnectedIdle);
+
+// The static half of the login form, built the way _buildLoginBody() does
+static void BM_LoginBodyPrefix(benchmark::State& state) {
+  const uint8_t mac[6] = { 0x24, 0x0a, 0xc4, 0x12, 0x34, 0x56 };
+  char body[512];
+  uint32_t before = HostShim::allocations();
+  for (auto _ : state) {
+    PortalBuffer form(body, sizeof(body));
+    form.append("username=").appendEncoded("A12CS0001");
+    form.append("&password=").appendEncoded("p@ss word&more");
+    form.append("&client_mac=").appendMac(mac);
+    benchmark::DoNotOptimize(body);
+  }
+  countAllocations(state, before);
+}
+BENCHMARK(BM_LoginBodyPrefix);
+
+// One connectivity probe against the loopback portal
+static void BM_CheckInternet(benchmark::State& state) {
+  LoopbackPortal server;
+  server.start();
+  server.setAuthorized(true);
+  HostShim::setStationConnected(true);
+
+  ArduinoUTMWiFiPortal portal("user", "secret");
+  uint32_t before = HostShim::allocations();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(portal.checkInternet());
+  }
+  countAllocations(state, before);
+  server.stop();
+}
+BENCHMARK(BM_CheckInternet)->Unit(benchmark::kMicrosecond);
+
+// One full attemptLogin() round trip against the loopback portal. The
+// first login is left out so "allocs" shows the steady state of a
+// session renewal
+static void BM_AttemptLogin(benchmark::State& state) {
+  LoopbackPortal server;
+  server.start();
+  HostShim::setStationConnected(true);
+
+  ArduinoUTMWiFiPortal portal("user", "secret");
+  portal.attemptLogin();
+  uint32_t before = HostShim::allocations();
+  for (auto _ : state) {
+    server.setAuthorized(false);
+    benchmark::DoNotOptimize(portal.attemptLogin());
+  }
+  countAllocations(state, before);
+  server.stop();
+}
+BENCHMARK(BM_AttemptLogin)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,243 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+#include "LoopbackPortal.h"
+#include "HostShim.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+
+static const char REDIRECT_LOCATION[] =
+  "http://wifi.utm.my/?sip=utm-vsz-new.utm.my&mac=00%3A1b%3A2f%3Aaa%3Abb%3Acc"
+  "&client_mac=24%3A0a%3Ac4%3A12%3A34%3A56&uip=10.0.0.2&dn=utm-vsz-new.utm.my"
+  "&url=http%3A%2F%2Fconnectivitycheck.gstatic.com%2Fgenerate_204";
+
+LoopbackPortal::LoopbackPortal()
+  : _probeSocket(-1), _portalSocket(-1), _keptSocket(-1), _running(false), _authorized(false),
+    _loginAccepted(true), _loginDelayMs(0), _probeDelayMs(0), _keepAlive(false), _probes(0),
+    _logins(0), _dropped(0), _redirectLocation(REDIRECT_LOCATION) {
+}
+
+LoopbackPortal::~LoopbackPortal() {
+  stop();
+}
+
+bool LoopbackPortal::start() {
+  uint16_t probePort = 0;
+  uint16_t portalPort = 0;
+  _probeSocket = _listen(probePort);
+  _portalSocket = _listen(portalPort);
+  if (_probeSocket < 0 || _portalSocket < 0) {
+    stop();
+    return false;
+  }
+  HostShim::mapPort(80, probePort);
+  HostShim::mapPort(443, probePort);
+  HostShim::mapPort(9998, portalPort);
+  _running = true;
+  _thread = std::thread(&LoopbackPortal::_serve, this);
+  return true;
+}
+
+void LoopbackPortal::stop() {
+  _running = false;
+  if (_thread.joinable()) {
+    _thread.join();
+  }
+  if (_probeSocket >= 0) {
+    close(_probeSocket);
+    _probeSocket = -1;
+  }
+  if (_portalSocket >= 0) {
+    close(_portalSocket);
+    _portalSocket = -1;
+  }
+  if (_keptSocket >= 0) {
+    close(_keptSocket);
+    _keptSocket = -1;
+  }
+  HostShim::clearPortMap();
+}
+
+std::string LoopbackPortal::lastLoginBody() {
+  std::lock_guard<std::mutex> lock(_textMutex);
+  return _lastLoginBody;
+}
+
+void LoopbackPortal::setRedirectLocation(const std::string& location) {
+  std::lock_guard<std::mutex> lock(_textMutex);
+  _redirectLocation = location;
+}
+
+int LoopbackPortal::_listen(uint16_t& port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  int reuse = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+  socklen_t length = sizeof(address);
+  if (bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(fd, 8) < 0 ||
+      getsockname(fd, (struct sockaddr*)&address, &length) < 0) {
+    close(fd);
+    return -1;
+  }
+  port = ntohs(address.sin_port);
+  return fd;
+}
+
+void LoopbackPortal::_serve() {
+  while (_running) {
+    struct pollfd listeners[3] = { { _probeSocket, POLLIN, 0 }, { _portalSocket, POLLIN, 0 },
+                                   { _keptSocket, POLLIN, 0 } };
+    if (poll(listeners, (_keptSocket >= 0) ? 3 : 2, 20) <= 0) {
+      continue;
+    }
+    if (_keptSocket >= 0 && listeners[2].revents != 0) {
+      // A request (or the close) on the kept-alive connection: drop it
+      close(_keptSocket);
+      _keptSocket = -1;
+      _dropped++;
+    }
+    for (int i = 0; i < 2; i++) {
+      if ((listeners[i].revents & POLLIN) == 0) {
+        continue;
+      }
+      int connection = accept(listeners[i].fd, NULL, NULL);
+      if (connection < 0) {
+        continue;
+      }
+      if (_handle(connection, i == 1) && _keptSocket < 0) {
+        _keptSocket = connection;
+      } else {
+        close(connection);
+      }
+    }
+  }
+}
+
+bool LoopbackPortal::_handle(int socket, bool portal) {
+  struct timeval timeout = { 2, 0 };
+  setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  // Request head, then as much body as Content-Length announces. A TCP
+  // probe connects and closes without a request.
+  std::string request;
+  size_t headEnd = std::string::npos;
+  char chunk[512];
+  while (headEnd == std::string::npos && request.size() < 16384) {
+    ssize_t received = recv(socket, chunk, sizeof(chunk), 0);
+    if (received <= 0) {
+      return false;
+    }
+    request.append(chunk, received);
+    headEnd = request.find("\r\n\r\n");
+  }
+  if (headEnd == std::string::npos) {
+    return false;
+  }
+  size_t contentLength = 0;
+  const char* lengthHeader = strcasestr(request.c_str(), "\r\nContent-Length:");
+  if (lengthHeader != NULL && (size_t)(lengthHeader - request.c_str()) < headEnd) {
+    contentLength = strtoul(lengthHeader + 17, NULL, 10);
+  }
+  std::string body = request.substr(headEnd + 4);
+  while (body.size() < contentLength) {
+    ssize_t received = recv(socket, chunk, sizeof(chunk), 0);
+    if (received <= 0) {
+      break;
+    }
+    body.append(chunk, received);
+  }
+
+  if (portal) {
+    return _answerLogin(socket, body);
+  }
+  _answerProbe(socket);
+  return false;
+}
+
+void LoopbackPortal::_answerProbe(int socket) {
+  _probes++;
+  if (_probeDelayMs > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(_probeDelayMs.load()));
+  }
+  std::string response;
+  if (_authorized) {
+    response = "HTTP/1.1 204 No Content\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+  } else {
+    std::lock_guard<std::mutex> lock(_textMutex);
+    response = "HTTP/1.1 302 Found\r\nLocation: " + _redirectLocation +
+               "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+  }
+  send(socket, response.data(), response.size(), MSG_NOSIGNAL);
+}
+
+bool LoopbackPortal::_answerLogin(int socket, const std::string& body) {
+  _logins++;
+  {
+    std::lock_guard<std::mutex> lock(_textMutex);
+    _lastLoginBody = body;
+  }
+  if (_loginDelayMs > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(_loginDelayMs.load()));
+  }
+
+  int status = 200;
+  const char* page;
+  if (!_loginAccepted) {
+    status = 500;
+    page = "<html><body>Service temporarily unavailable.</body></html>";
+  } else if (_formHas(body, "username") && _formHas(body, "password")) {
+    _authorized = true;
+    page = "<html><body>Welcome! You are now logged in.</body></html>";
+  } else {
+    page = "<html><body>Authentication failed: invalid user.</body></html>";
+  }
+  bool keepAlive = (_keepAlive && status != 200);
+  char head[160];
+  snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: text/html\r\nContent-Length: %u\r\nConnection: %s\r\n\r\n",
+           status, status == 200 ? "OK" : "Internal Server Error", (unsigned)strlen(page),
+           keepAlive ? "keep-alive" : "close");
+  std::string response = std::string(head) + page;
+  send(socket, response.data(), response.size(), MSG_NOSIGNAL);
+  return keepAlive;
+}
+
+bool LoopbackPortal::_formHas(const std::string& body, const char* key) {
+  // application/x-www-form-urlencoded: key=value pairs separated by '&'
+  size_t start = 0;
+  while (start <= body.size()) {
+    size_t end = body.find('&', start);
+    if (end == std::string::npos) {
+      end = body.size();
+    }
+    std::string field = body.substr(start, end - start);
+    size_t equals = field.find('=');
+    if (equals != std::string::npos && field.compare(0, equals, key) == 0 && equals + 1 < field.size()) {
+      return true;
+    }
+    start = end + 1;
+  }
+  return false;
+}
@@ -0,0 +1,88 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+#ifndef LoopbackPortal_h
+#define LoopbackPortal_h
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Stand-in for the internet and the SmartZone controller on 127.0.0.1,
+// for host tests and benchmarks. Ports 80 and 443 (probes) and 9998
+// (login) are mapped onto it through HostShim while it runs.
+//  - Probes get 204 once logged in, else a 302 to the portal carrying
+//    sip, mac, uip, dn and url like the real controller.
+//  - A login POST whose form has a non-empty username and password logs
+//    the client in and answers with a welcome page.
+//  - With keep-alive on, a refused login leaves the connection open, and
+//    the next request on it is closed unanswered, like a portal that has
+//    timed the idle connection out.
+class LoopbackPortal {
+  public:
+    LoopbackPortal();
+    ~LoopbackPortal();
+
+    bool start();
+    void stop();
+
+    // Client logged in (probes answered with 204)
+    void setAuthorized(bool authorized) { _authorized = authorized; }
+    bool authorized() const { return _authorized; }
+
+    // false: logins are answered with 500 and change nothing
+    void setLoginAccepted(bool accepted) { _loginAccepted = accepted; }
+
+    // Time taken before answering a login or a probe
+    void setLoginDelay(unsigned long delayMs) { _loginDelayMs = delayMs; }
+    void setProbeDelay(unsigned long delayMs) { _probeDelayMs = delayMs; }
+
+    void setKeepAlive(bool keepAlive) { _keepAlive = keepAlive; }
+
+    // Location of the probe redirect (default: the controller's, with sip)
+    void setRedirectLocation(const std::string& location);
+
+    uint32_t probes() const { return _probes; }
+    uint32_t logins() const { return _logins; }
+    uint32_t dropped() const { return _dropped; }
+    std::string lastLoginBody();
+
+  private:
+    void _serve();
+    bool _handle(int socket, bool portal);
+    void _answerProbe(int socket);
+    bool _answerLogin(int socket, const std::string& body);
+    static int _listen(uint16_t& port);
+    static bool _formHas(const std::string& body, const char* key);
+
+    int _probeSocket;
+    int _portalSocket;
+    int _keptSocket;
+    std::thread _thread;
+    std::atomic<bool> _running;
+    std::atomic<bool> _authorized;
+    std::atomic<bool> _loginAccepted;
+    std::atomic<unsigned long> _loginDelayMs;
+    std::atomic<unsigned long> _probeDelayMs;
+    std::atomic<bool> _keepAlive;
+    std::atomic<uint32_t> _probes;
+    std::atomic<uint32_t> _logins;
+    std::atomic<uint32_t> _dropped;
+    std::mutex _textMutex;
+    std::string _lastLoginBody;
+    std::string _redirectLocation;
+};
+
+#endif
@@ -0,0 +1,65 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+// Counting replacements for the global allocation functions, so the
+// benchmarks can report allocations per operation. The count is per
+// thread: the loopback portal's own allocations stay out of it
+#include "HostShim.h"
+#include <new>
+#include <stdlib.h>
+
+static thread_local uint32_t allocationCount = 0;
+
+void* operator new(size_t size) {
+  allocationCount++;
+  void* block = malloc(size > 0 ? size : 1);
+  if (block == NULL) {
+    throw std::bad_alloc();
+  }
+  return block;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  allocationCount++;
+  return malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+  return operator new(size, tag);
+}
+
+void operator delete(void* block) noexcept {
+  free(block);
+}
+
+void operator delete[](void* block) noexcept {
+  free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+  free(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+  free(block);
+}
+
+namespace HostShim {
+  uint32_t allocations() {
+    return allocationCount;
+  }
+}
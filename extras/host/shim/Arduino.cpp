@@ -0,0 +1,170 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "HostShim.h"
+#include <stdarg.h>
+#include <time.h>
+#include <sched.h>
+
+HardwareSerial Serial;
+
+static bool loggingEnabled = false;
+static unsigned long millisOffset = 0;
+
+static uint64_t monotonicUs() {
+  static struct timespec start;
+  static bool started = false;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  if (!started) {
+    start = now;
+    started = true;
+  }
+  return (uint64_t)(now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000;
+}
+
+unsigned long millis() {
+  return (unsigned long)(monotonicUs() / 1000) + millisOffset;
+}
+
+unsigned long micros() {
+  return (unsigned long)monotonicUs() + millisOffset * 1000;
+}
+
+void delay(unsigned long ms) {
+  struct timespec wait;
+  wait.tv_sec = ms / 1000;
+  wait.tv_nsec = (long)(ms % 1000) * 1000000;
+  nanosleep(&wait, NULL);
+}
+
+void yield() {
+  sched_yield();
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t written = 0;
+  while (written < size && write(buffer[written]) == 1) {
+    written++;
+  }
+  return written;
+}
+
+void String::toLowerCase() {
+  for (size_t i = 0; i < _text.size(); i++) {
+    if (_text[i] >= 'A' && _text[i] <= 'Z') {
+      _text[i] += 'a' - 'A';
+    }
+  }
+}
+
+void String::replace(const char* find, const char* replacement) {
+  size_t findLength = strlen(find);
+  if (findLength == 0) {
+    return;
+  }
+  size_t position = 0;
+  while ((position = _text.find(find, position)) != std::string::npos) {
+    _text.replace(position, findLength, replacement);
+    position += strlen(replacement);
+  }
+}
+
+int Stream::timedRead() {
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if (c >= 0) {
+      return c;
+    }
+    yield();
+  } while (millis() - start < _timeout);
+  return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0) {
+      break;
+    }
+    buffer[count++] = (char)c;
+  }
+  return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char* buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0 || c == terminator) {
+      break;
+    }
+    buffer[count++] = (char)c;
+  }
+  return count;
+}
+
+size_t HardwareSerial::print(const char* text) {
+  if (!loggingEnabled) {
+    return 0;
+  }
+  return fputs(text, stdout) >= 0 ? strlen(text) : 0;
+}
+
+size_t HardwareSerial::println(const char* text) {
+  if (!loggingEnabled) {
+    return 0;
+  }
+  return print(text) + print("\n");
+}
+
+size_t HardwareSerial::printf(const char* format, ...) {
+  if (!loggingEnabled) {
+    return 0;
+  }
+  va_list args;
+  va_start(args, format);
+  int written = vprintf(format, args);
+  va_end(args);
+  return written > 0 ? (size_t)written : 0;
+}
+
+String IPAddress::toString() const {
+  char text[16];
+  snprintf(text, sizeof(text), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+  return String(text);
+}
+
+bool IPAddress::fromString(const char* text) {
+  unsigned a, b, c, d;
+  char extra;
+  if (sscanf(text, "%u.%u.%u.%u%c", &a, &b, &c, &d, &extra) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+    return false;
+  }
+  *this = IPAddress(a, b, c, d);
+  return true;
+}
+
+namespace HostShim {
+  void advanceMillis(unsigned long ms) {
+    millisOffset += ms;
+  }
+
+  void setLogging(bool enabled) {
+    loggingEnabled = enabled;
+  }
+}
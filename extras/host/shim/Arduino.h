@@ -0,0 +1,113 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+// Host shim: the part of the Arduino core the library uses, on POSIX.
+// Only for the CMake host build (ARDUINO_UTM_HOST); see extras/host.
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <string>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+
+// Flash access is plain memory access on the host
+#define PROGMEM
+#define PSTR(s) (s)
+#define strlen_P strlen
+#define memcpy_P memcpy
+#define strncasecmp_P strncasecmp
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_ptr(addr) (*(const void* const*)(addr))
+
+// Monotonic clock since start-up, plus any HostShim::advanceMillis() offset
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+// Just enough of Arduino's String for the library
+class String {
+  public:
+    String(const char* text = "") : _text(text != NULL ? text : "") {}
+    String& operator=(const char* text) { _text = (text != NULL) ? text : ""; return *this; }
+    unsigned int length() const { return _text.size(); }
+    const char* c_str() const { return _text.c_str(); }
+    bool operator==(const char* text) const { return _text == text; }
+    bool operator==(const String& other) const { return _text == other._text; }
+
+    String& operator+=(const char* text) { _text += (text != NULL) ? text : ""; return *this; }
+    String& operator+=(const String& other) { _text += other._text; return *this; }
+    String& operator+=(char c) { _text += c; return *this; }
+    friend String operator+(String left, const String& right) { return left += right; }
+    friend String operator+(String left, const char* right) { return left += right; }
+    friend String operator+(const char* left, const String& right) { return String(left) += right; }
+
+    void toLowerCase();
+    void replace(const char* find, const char* replacement);
+
+  private:
+    std::string _text;
+};
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t print(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+};
+
+// Arduino's Stream: timed reads on top of available()/read()
+class Stream : public Print {
+  public:
+    Stream() : _timeout(1000) {}
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeoutMs) { _timeout = timeoutMs; }
+    unsigned long getTimeout() const { return _timeout; }
+    size_t readBytes(char* buffer, size_t length);
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+    size_t readBytesUntil(char terminator, char* buffer, size_t length);
+
+  protected:
+    // Next byte, or -1 after _timeout ms without one
+    virtual int timedRead();
+
+    unsigned long _timeout;
+};
+
+// Serial output goes to stdout when HostShim::setLogging(true)
+class HardwareSerial {
+  public:
+    void begin(unsigned long) {}
+    size_t print(const char* text);
+    size_t println(const char* text = "");
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,143 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+#include "HTTPClient.h"
+
+HTTPClient::HTTPClient() {
+  _client = NULL;
+  _port = 80;
+  _timeout = 5000;
+  _headerCount = 0;
+}
+
+bool HTTPClient::begin(WiFiClient& client, const char* url) {
+  // http[s]://host[:port]/path
+  uint16_t defaultPort = 80;
+  const char* host;
+  if (strncmp(url, "http://", 7) == 0) {
+    host = url + 7;
+  } else if (strncmp(url, "https://", 8) == 0) {
+    host = url + 8;
+    defaultPort = 443;
+  } else {
+    return false;
+  }
+  const char* path = strchr(host, '/');
+  std::string authority = path != NULL ? std::string(host, path - host) : std::string(host);
+  size_t colon = authority.find(':');
+  _host = authority.substr(0, colon);
+  _port = (colon != std::string::npos) ? (uint16_t)atoi(authority.c_str() + colon + 1) : defaultPort;
+  _path = (path != NULL) ? path : "/";
+  _requestHeaders.clear();
+  _client = &client;
+  return !_host.empty();
+}
+
+void HTTPClient::addHeader(const String& name, const String& value) {
+  _requestHeaders += std::string(name.c_str()) + ": " + value.c_str() + "\r\n";
+}
+
+void HTTPClient::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+  _headerCount = (headerKeysCount < MAX_HEADERS) ? headerKeysCount : MAX_HEADERS;
+  for (size_t i = 0; i < _headerCount; i++) {
+    _headerKeys[i] = headerKeys[i];
+    _headerValues[i].clear();
+  }
+}
+
+String HTTPClient::header(const char* name) {
+  for (size_t i = 0; i < _headerCount; i++) {
+    if (strcasecmp(_headerKeys[i], name) == 0) {
+      return String(_headerValues[i].c_str());
+    }
+  }
+  return String();
+}
+
+int HTTPClient::GET() {
+  return _send("GET", NULL, 0);
+}
+
+int HTTPClient::POST(const String& payload) {
+  return _send("POST", (const uint8_t*)payload.c_str(), payload.length());
+}
+
+int HTTPClient::POST(uint8_t* payload, size_t size) {
+  return _send("POST", payload, size);
+}
+
+String HTTPClient::errorToString(int error) {
+  switch (error) {
+    case HTTPC_ERROR_CONNECTION_REFUSED: return String("connection refused");
+    case HTTPC_ERROR_READ_TIMEOUT:       return String("read Timeout");
+    default:                             return String();
+  }
+}
+
+int HTTPClient::_send(const char* method, const uint8_t* payload, size_t size) {
+  if (_client == NULL) {
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+  _client->setTimeout(_timeout);
+  if (!_client->connect(_host.c_str(), _port)) {
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+  std::string request = std::string(method) + " " + _path + " HTTP/1.1\r\nHost: " + _host + "\r\n" +
+                        _requestHeaders + "Connection: close\r\n";
+  if (payload != NULL) {
+    request += "Content-Length: " + std::to_string(size) + "\r\n\r\n";
+    request.append((const char*)payload, size);
+  } else {
+    request += "\r\n";
+  }
+  _client->write((const uint8_t*)request.data(), request.size());
+
+  char line[512];
+  size_t length = _client->readBytesUntil('\n', line, sizeof(line) - 1);
+  line[length] = '\0';
+  if (length < 12 || strncmp(line, "HTTP/1.", 7) != 0) {
+    return HTTPC_ERROR_READ_TIMEOUT;
+  }
+  int status = atoi(line + 9);
+
+  while (true) {
+    length = _client->readBytesUntil('\n', line, sizeof(line) - 1);
+    if (length > 0 && line[length - 1] == '\r') {
+      length--;
+    }
+    line[length] = '\0';
+    if (length == 0) {
+      break;
+    }
+    const char* colon = strchr(line, ':');
+    if (colon == NULL) {
+      continue;
+    }
+    for (size_t i = 0; i < _headerCount; i++) {
+      if (strlen(_headerKeys[i]) == (size_t)(colon - line) && strncasecmp(line, _headerKeys[i], colon - line) == 0) {
+        const char* value = colon + 1;
+        while (*value == ' ') {
+          value++;
+        }
+        _headerValues[i] = value;
+      }
+    }
+  }
+  return status;
+}
+
+void HTTPClient::end() {
+  if (_client != NULL) {
+    _client->stop();
+  }
+}
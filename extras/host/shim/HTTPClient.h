@@ -0,0 +1,62 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+#ifndef HTTPClient_h
+#define HTTPClient_h
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+#define HTTP_CODE_OK 200
+#define HTTP_CODE_NO_CONTENT 204
+#define HTTP_CODE_FOUND 302
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+// HTTP/1.1 client with the part of the ESP32 HTTPClient interface the
+// library uses: GET and POST, one request per connection, collected
+// response headers only. https:// URLs are plain TCP, like the shim's
+// WiFiClientSecure.
+class HTTPClient {
+  public:
+    HTTPClient();
+
+    bool begin(WiFiClient& client, const char* url);
+    void setTimeout(uint16_t timeoutMs) { _timeout = timeoutMs; }
+    void setConnectTimeout(int32_t timeoutMs) { _timeout = timeoutMs; }
+    void addHeader(const String& name, const String& value);
+    void collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+    String header(const char* name);
+    int GET();
+    int POST(const String& payload);
+    int POST(uint8_t* payload, size_t size);
+    String errorToString(int error);
+    void end();
+
+  private:
+    static const size_t MAX_HEADERS = 4;
+
+    int _send(const char* method, const uint8_t* payload, size_t size);
+
+    WiFiClient* _client;
+    std::string _host;
+    std::string _path;
+    std::string _requestHeaders;
+    uint16_t _port;
+    unsigned long _timeout;
+    const char* _headerKeys[MAX_HEADERS];
+    std::string _headerValues[MAX_HEADERS];
+    size_t _headerCount;
+};
+
+#endif
@@ -0,0 +1,42 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+#ifndef HostShim_h
+#define HostShim_h
+
+#include <stdint.h>
+
+// Controls for the host build that have no counterpart on the devices
+namespace HostShim {
+  // Route connections to port on 127.0.0.1 to localPort instead
+  void mapPort(uint16_t port, uint16_t localPort);
+  void clearPortMap();
+
+  // Station state seen through WiFi.status()
+  void setStationConnected(bool connected);
+
+  // DNS: make lookups fail, or take delayMs each
+  void setDnsFailing(bool failing);
+  void setDnsDelay(unsigned long delayMs);
+
+  // Move millis() forward without waiting
+  void advanceMillis(unsigned long ms);
+
+  // Print the library's Serial output to stdout
+  void setLogging(bool enabled);
+
+  // operator new calls made by the calling thread since it started
+  uint32_t allocations();
+}
+
+#endif
@@ -0,0 +1,45 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+#ifndef IPAddress_h
+#define IPAddress_h
+
+#include "Arduino.h"
+
+// IPv4 address in network byte order, as in the ESP cores
+class IPAddress {
+  public:
+    IPAddress() { _address.dword = 0; }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+      _address.bytes[0] = a;
+      _address.bytes[1] = b;
+      _address.bytes[2] = c;
+      _address.bytes[3] = d;
+    }
+    IPAddress(uint32_t address) { _address.dword = address; }
+
+    operator uint32_t() const { return _address.dword; }
+    uint8_t operator[](int index) const { return _address.bytes[index]; }
+    bool operator==(const IPAddress& other) const { return _address.dword == other._address.dword; }
+
+    String toString() const;
+    bool fromString(const char* text);
+
+  private:
+    union {
+      uint8_t bytes[4];
+      uint32_t dword;
+    } _address;
+};
+
+#endif
@@ -0,0 +1,293 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+#include "WiFi.h"
+#include "WiFiClient.h"
+#include "HostShim.h"
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+
+WiFiClass WiFi;
+
+static const uint8_t STATION_MAC[6] = { 0x24, 0x0a, 0xc4, 0x12, 0x34, 0x56 };
+static const uint8_t AP_BSSID[6] = { 0x00, 0x1b, 0x2f, 0xaa, 0xbb, 0xcc };
+
+static bool stationConnected = true;
+static bool dnsFailing = false;
+static unsigned long dnsDelayMs = 0;
+
+static const size_t MAX_PORT_MAPS = 8;
+static uint16_t mappedPorts[MAX_PORT_MAPS][2];
+static size_t portMapCount = 0;
+
+// "24:0A:C4:12:34:56", as the cores print it
+static String formatMac(const uint8_t* mac) {
+  char text[18];
+  snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  return String(text);
+}
+
+static uint16_t localPort(uint16_t port) {
+  for (size_t i = 0; i < portMapCount; i++) {
+    if (mappedPorts[i][0] == port) {
+      return mappedPorts[i][1];
+    }
+  }
+  return port;
+}
+
+namespace HostShim {
+  void mapPort(uint16_t port, uint16_t local) {
+    for (size_t i = 0; i < portMapCount; i++) {
+      if (mappedPorts[i][0] == port) {
+        mappedPorts[i][1] = local;
+        return;
+      }
+    }
+    if (portMapCount < MAX_PORT_MAPS) {
+      mappedPorts[portMapCount][0] = port;
+      mappedPorts[portMapCount][1] = local;
+      portMapCount++;
+    }
+  }
+
+  void clearPortMap() {
+    portMapCount = 0;
+  }
+
+  void setStationConnected(bool connected) {
+    stationConnected = connected;
+  }
+
+  void setDnsFailing(bool failing) {
+    dnsFailing = failing;
+  }
+
+  void setDnsDelay(unsigned long delayMs) {
+    dnsDelayMs = delayMs;
+  }
+}
+
+wl_status_t WiFiClass::status() {
+  return stationConnected ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+IPAddress WiFiClass::localIP() {
+  return stationConnected ? IPAddress(10, 0, 0, 2) : IPAddress();
+}
+
+uint8_t* WiFiClass::macAddress(uint8_t* mac) {
+  memcpy(mac, STATION_MAC, sizeof(STATION_MAC));
+  return mac;
+}
+
+String WiFiClass::macAddress() {
+  return formatMac(STATION_MAC);
+}
+
+const uint8_t* WiFiClass::BSSID() {
+  return stationConnected ? AP_BSSID : NULL;
+}
+
+String WiFiClass::BSSIDstr() {
+  return stationConnected ? formatMac(AP_BSSID) : String();
+}
+
+int32_t WiFiClass::channel() {
+  return stationConnected ? 6 : 0;
+}
+
+String WiFiClass::SSID() {
+  return String(stationConnected ? "UTMWiFi" : "");
+}
+
+int WiFiClass::hostByName(const char* host, IPAddress& address) {
+  (void)host;
+  if (dnsDelayMs > 0) {
+    delay(dnsDelayMs);
+  }
+  if (dnsFailing || !stationConnected) {
+    address = IPAddress();
+    return 0;
+  }
+  address = IPAddress(127, 0, 0, 1);
+  return 1;
+}
+
+wl_status_t WiFiClass::begin(const char*, const char*, int32_t, const uint8_t*, bool) {
+  stationConnected = true;
+  return WL_CONNECTED;
+}
+
+bool WiFiClass::disconnect(bool) {
+  stationConnected = false;
+  return true;
+}
+
+bool WiFiClass::mode(wifi_mode_t) {
+  return true;
+}
+
+bool WiFiClass::setAutoReconnect(bool) {
+  return true;
+}
+
+bool WiFiClass::persistent(bool) {
+  return true;
+}
+
+WiFiClient::WiFiClient() {
+  _socket = -1;
+}
+
+WiFiClient::~WiFiClient() {
+  stop();
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+  stop();
+  if (!stationConnected) {
+    return 0;
+  }
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return 0;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  int noDelay = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+  struct sockaddr_in server;
+  memset(&server, 0, sizeof(server));
+  server.sin_family = AF_INET;
+  server.sin_port = htons(localPort(port));
+  server.sin_addr.s_addr = (uint32_t)ip;
+  if (::connect(fd, (struct sockaddr*)&server, sizeof(server)) < 0) {
+    // Wait for the connect like the cores do, bounded by the stream timeout
+    struct pollfd pending = { fd, POLLOUT, 0 };
+    int error = 0;
+    socklen_t errorLength = sizeof(error);
+    if (errno != EINPROGRESS || poll(&pending, 1, (int)_timeout) != 1 ||
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) != 0 || error != 0) {
+      close(fd);
+      return 0;
+    }
+  }
+  _socket = fd;
+  return 1;
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+  IPAddress address;
+  if (!WiFi.hostByName(host, address)) {
+    return 0;
+  }
+  return connect(address, port);
+}
+
+size_t WiFiClient::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+  if (_socket < 0) {
+    return 0;
+  }
+  size_t written = 0;
+  while (written < size) {
+    ssize_t sent = send(_socket, buffer + written, size - written, MSG_NOSIGNAL);
+    if (sent > 0) {
+      written += sent;
+      continue;
+    }
+    struct pollfd pending = { _socket, POLLOUT, 0 };
+    if (sent < 0 && errno == EAGAIN && poll(&pending, 1, (int)_timeout) == 1) {
+      continue;
+    }
+    break;
+  }
+  return written;
+}
+
+int WiFiClient::available() {
+  if (_socket < 0) {
+    return 0;
+  }
+  int pending = 0;
+  if (ioctl(_socket, FIONREAD, &pending) < 0) {
+    return 0;
+  }
+  return pending;
+}
+
+int WiFiClient::read() {
+  uint8_t c;
+  return (read(&c, 1) == 1) ? c : -1;
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+  if (_socket < 0) {
+    return -1;
+  }
+  ssize_t received = recv(_socket, buffer, size, MSG_DONTWAIT);
+  return (received > 0) ? (int)received : -1;
+}
+
+int WiFiClient::peek() {
+  uint8_t c;
+  if (_socket < 0 || recv(_socket, &c, 1, MSG_DONTWAIT | MSG_PEEK) != 1) {
+    return -1;
+  }
+  return c;
+}
+
+int WiFiClient::timedRead() {
+  if (_socket < 0) {
+    return -1;
+  }
+  int c = read();
+  if (c >= 0) {
+    return c;
+  }
+  struct pollfd pending = { _socket, POLLIN, 0 };
+  if (poll(&pending, 1, (int)_timeout) != 1) {
+    return -1;
+  }
+  return read();
+}
+
+void WiFiClient::stop() {
+  if (_socket >= 0) {
+    close(_socket);
+    _socket = -1;
+  }
+}
+
+uint8_t WiFiClient::connected() {
+  if (_socket < 0) {
+    return 0;
+  }
+  // Open until the peer's FIN has been read; buffered data still counts
+  uint8_t c;
+  ssize_t received = recv(_socket, &c, 1, MSG_DONTWAIT | MSG_PEEK);
+  if (received == 0) {
+    return 0;
+  }
+  return (received > 0 || errno == EAGAIN || errno == EWOULDBLOCK) ? 1 : 0;
+}
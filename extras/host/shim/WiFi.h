@@ -0,0 +1,48 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+
+#ifndef WiFi_h
+#define WiFi_h
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "WiFiClient.h"
+
+enum wifi_mode_t { WIFI_OFF = 0, WIFI_STA = 1 };
+enum wl_status_t { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 };
+
+// A station that is always associated with the same AP unless a test
+// says otherwise (HostShim::setStationConnected). Every name resolves to
+// 127.0.0.1.
+class WiFiClass {
+  public:
+    wl_status_t status();
+    IPAddress localIP();
+    uint8_t* macAddress(uint8_t* mac);
+    String macAddress();
+    const uint8_t* BSSID();
+    String BSSIDstr();
+    int32_t channel();
+    String SSID();
+    int hostByName(const char* host, IPAddress& address);
+    wl_status_t begin(const char* ssid, const char* passphrase = NULL, int32_t channel = 0,
+                      const uint8_t* bssid = NULL, bool connect = true);
+    bool disconnect(bool wifiOff = false);
+    bool mode(wifi_mode_t mode);
+    bool setAutoReconnect(bool autoReconnect);
+    bool persistent(bool persistent);
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,295 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include "ArduinoUTMWiFiPortal.h"
+#include "HostShim.h"
+#include "LoopbackPortal.h"
+
+// Probes and logins against the loopback stand-in
+class LoginTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+      HostShim::setStationConnected(true);
+      HostShim::setDnsFailing(false);
+      ASSERT_TRUE(_server.start());
+      _portal.setProbeCacheTtl(0);
+    }
+
+    void TearDown() override {
+      _server.stop();
+    }
+
+    // Call keepConnected() every 250 ms of simulated time. While a login
+    // answer is awaited, wait for it in real time: the loopback portal
+    // answers on its own thread.
+    void run(unsigned long ms) {
+      for (unsigned long t = 0; t < ms; t += 250) {
+        _portal.keepConnected();
+        for (int i = 0; i < 1000 && _portal.getState() == ArduinoUTMWiFiPortal::PORTAL_AWAITING_LOGIN; i++) {
+          usleep(1000);
+          _portal.keepConnected();
+        }
+        HostShim::advanceMillis(250);
+      }
+    }
+
+    // Step keepConnected() through the idle wait to the next probe
+    void untilProbing() {
+      for (int i = 0; i < 40 && _portal.getState() != ArduinoUTMWiFiPortal::PORTAL_PROBING; i++) {
+        _portal.keepConnected();
+        HostShim::advanceMillis(250);
+      }
+      ASSERT_EQ(ArduinoUTMWiFiPortal::PORTAL_PROBING, _portal.getState());
+    }
+
+    LoopbackPortal _server;
+    ArduinoUTMWiFiPortal _portal{"user", "secret"};
+};
+
+TEST_F(LoginTest, ProbeSeesPortal) {
+  EXPECT_FALSE(_portal.checkInternet());
+  _server.setAuthorized(true);
+  EXPECT_TRUE(_portal.checkInternet());
+  EXPECT_EQ(2u, _server.probes());
+}
+
+TEST_F(LoginTest, LoginAuthorizes) {
+  ASSERT_TRUE(_portal.attemptLogin());
+  EXPECT_EQ(0u, _server.lastLoginBody().find("username=user&password=secret&"));
+  EXPECT_EQ(ArduinoUTMWiFiPortal::LOGIN_OK, _portal.getLastLoginResult());
+  EXPECT_TRUE(_server.authorized());
+  EXPECT_TRUE(_portal.checkInternet());
+}
+
+TEST_F(LoginTest, ServerErrorFails) {
+  _server.setLoginAccepted(false);
+  EXPECT_FALSE(_portal.attemptLogin());
+  EXPECT_EQ(ArduinoUTMWiFiPortal::LOGIN_SERVER_ERROR, _portal.getLastLoginResult());
+  EXPECT_FALSE(_server.authorized());
+}
+
+TEST_F(LoginTest, RejectedCredentialsAreReported) {
+  ArduinoUTMWiFiPortal portal("user", "");
+  EXPECT_FALSE(portal.attemptLogin());
+  EXPECT_EQ(ArduinoUTMWiFiPortal::LOGIN_BAD_CREDENTIALS, portal.getLastLoginResult());
+  EXPECT_FALSE(_server.authorized());
+}
+
+TEST_F(LoginTest, NoLoginWithoutStation) {
+  HostShim::setStationConnected(false);
+  EXPECT_FALSE(_portal.attemptLogin());
+  EXPECT_EQ(0u, _server.logins());
+}
+
+TEST_F(LoginTest, KeepConnectedLogsInBehindPortal) {
+  _portal.setCheckInterval(1000);
+  for (int i = 0; i < 20 && !_server.authorized(); i++) {
+    _portal.keepConnected();
+    HostShim::advanceMillis(1000);
+  }
+  for (int i = 0; i < 5 && _portal.getState() != ArduinoUTMWiFiPortal::PORTAL_IDLE; i++) {
+    _portal.keepConnected();
+    HostShim::advanceMillis(1000);
+  }
+  EXPECT_EQ(ArduinoUTMWiFiPortal::PORTAL_IDLE, _portal.getState());
+  EXPECT_EQ(1u, _server.logins());
+}
+
+TEST_F(LoginTest, ProbeCutShortByBudgetIsNoVerdict) {
+  _server.setAuthorized(true);
+  _server.setProbeDelay(100);
+  _portal.setStepBudget(10000);
+  untilProbing();
+
+  // Each cut-short probe keeps the state, within the budget
+  for (int i = 0; i < 3; i++) {
+    unsigned long start = millis();
+    _portal.keepConnected();
+    EXPECT_LT(millis() - start, 50u);
+    EXPECT_EQ(ArduinoUTMWiFiPortal::PORTAL_PROBING, _portal.getState());
+  }
+  // Then the failure counts
+  _portal.keepConnected();
+  EXPECT_EQ(ArduinoUTMWiFiPortal::PORTAL_LOGGING_IN, _portal.getState());
+}
+
+TEST_F(LoginTest, FastFailureIsAVerdict) {
+  _portal.setStepBudget(50000);
+  untilProbing();
+  _portal.keepConnected();
+  EXPECT_EQ(ArduinoUTMWiFiPortal::PORTAL_LOGGING_IN, _portal.getState());
+}
+
+TEST_F(LoginTest, CredentialsAreFormEncoded) {
+  ArduinoUTMWiFiPortal portal("A12CS0001", "p@ss word&x");
+  ASSERT_TRUE(portal.attemptLogin());
+  EXPECT_EQ(0u, _server.lastLoginBody().find("username=A12CS0001&password=p%40ss%20word%26x&"));
+}
+
+TEST_F(LoginTest, FormSurvivesRepeatedLogins) {
+  ASSERT_TRUE(_portal.attemptLogin());
+  std::string first = _server.lastLoginBody();
+  _server.setAuthorized(false);
+  ASSERT_TRUE(_portal.attemptLogin());
+  EXPECT_EQ(first, _server.lastLoginBody());
+  EXPECT_EQ(2u, _server.logins());
+}
+
+TEST_F(LoginTest, MinimalHeadersLogIn) {
+  _portal.setHeaderProfile(ArduinoUTMWiFiPortal::HEADERS_MINIMAL);
+  ASSERT_TRUE(_portal.attemptLogin());
+  EXPECT_TRUE(_server.authorized());
+}
+
+TEST_F(LoginTest, CountsHandshakes) {
+  ASSERT_TRUE(_portal.attemptLogin());
+  _server.setAuthorized(false);
+  ASSERT_TRUE(_portal.attemptLogin());
+  EXPECT_EQ(2ul, _portal.getFullHandshakes() + _portal.getResumedHandshakes());
+  EXPECT_EQ(0ul, _portal.getReusedConnections());
+}
+
+TEST_F(LoginTest, LoginTakesParametersFromRedirect) {
+  EXPECT_FALSE(_portal.checkInternet());
+  ASSERT_TRUE(_portal.attemptLogin());
+  std::string body = _server.lastLoginBody();
+  EXPECT_NE(std::string::npos, body.find("&mac=00%3A1b%3A2f%3Aaa%3Abb%3Acc"));
+  EXPECT_NE(std::string::npos, body.find("&uip=10.0.0.2"));
+  EXPECT_NE(std::string::npos, body.find("&url=http%3A%2F%2Fconnectivitycheck.gstatic.com%2Fgenerate_204"));
+}
+
+TEST_F(LoginTest, SlowAnswerOutlastsStepBudget) {
+  _portal.setProbeMode(ArduinoUTMWiFiPortal::PROBE_RAW_HTTP);
+  _portal.setStepBudget(50000);
+  _server.setLoginDelay(300);
+  for (int i = 0; i < 40 && !_portal.isOnline(); i++) {
+    run(250);
+  }
+  EXPECT_TRUE(_portal.isOnline());
+  EXPECT_EQ(1u, _server.logins());
+  EXPECT_EQ(ArduinoUTMWiFiPortal::LOGIN_OK, _portal.getLastLoginResult());
+}
+
+TEST_F(LoginTest, FailedRenewalWaitsForNextCheck) {
+  _portal.setProbeMode(ArduinoUTMWiFiPortal::PROBE_RAW_HTTP);
+  _portal.setSessionLifetime(100000);
+  _portal.setCheckInterval(30000);
+  for (int i = 0; i < 40 && _server.logins() == 0; i++) {
+    run(250);
+  }
+  ASSERT_EQ(1u, _server.logins());
+
+  // The renewal is due 85 s in; the portal refuses it, the session stays up
+  _server.setLoginAccepted(false);
+  for (int i = 0; i < 400 && _server.logins() == 1; i++) {
+    run(250);
+  }
+  ASSERT_EQ(2u, _server.logins());
+  run(20000);
+  EXPECT_EQ(2u, _server.logins());
+  EXPECT_EQ(ArduinoUTMWiFiPortal::PORTAL_IDLE, _portal.getState());
+
+  // After the hold-off it tries again, and a good renewal restarts the clock
+  _server.setLoginAccepted(true);
+  run(15000);
+  EXPECT_EQ(3u, _server.logins());
+  run(60000);
+  EXPECT_EQ(3u, _server.logins());
+}
+
+TEST_F(LoginTest, EarlyLogoutDoesNotShortenLifetime) {
+  _portal.setProbeMode(ArduinoUTMWiFiPortal::PROBE_RAW_HTTP);
+  _portal.setPreemptiveLogin(false);
+  _portal.setCheckInterval(5000);
+  // The portal ends each session after the given time; the next probe
+  // sees the redirect and the library logs in again
+  unsigned long sessions[] = {60000, 60000, 10000};
+  for (unsigned long sessionMs : sessions) {
+    uint32_t logins = _server.logins();
+    for (int i = 0; i < 200 && (_server.logins() == logins || !_portal.isOnline()); i++) {
+      run(250);
+    }
+    ASSERT_TRUE(_portal.isOnline());
+    run(sessionMs);
+    _server.setAuthorized(false);
+  }
+  uint32_t logins = _server.logins();
+  for (int i = 0; i < 200 && _server.logins() == logins; i++) {
+    run(250);
+  }
+  EXPECT_GE(_portal.getSessionLifetime(), 50000u);
+  EXPECT_LE(_portal.getSessionLifetime(), 61000u);
+
+  // Samples age out after a day
+  HostShim::advanceMillis(25UL * 3600 * 1000);
+  EXPECT_EQ(0u, _portal.getSessionLifetime());
+}
+
+TEST_F(LoginTest, DroppedKeptAliveSocketReconnectsInItsOwnStep) {
+  _portal.setProbeMode(ArduinoUTMWiFiPortal::PROBE_RAW_HTTP);
+  _server.setKeepAlive(true);
+  _server.setLoginAccepted(false);
+  for (int i = 0; i < 40 && _server.logins() == 0; i++) {
+    run(250);
+  }
+  ASSERT_EQ(1u, _server.logins());
+
+  // The retry reuses the socket, which the portal closes unanswered
+  _server.setLoginAccepted(true);
+  bool reconnected = false;
+  for (int i = 0; i < 4000 && !_portal.isOnline(); i++) {
+    ArduinoUTMWiFiPortal::PortalState before = _portal.getState();
+    unsigned long start = millis();
+    _portal.keepConnected();
+    if (before == ArduinoUTMWiFiPortal::PORTAL_AWAITING_LOGIN &&
+        _portal.getState() == ArduinoUTMWiFiPortal::PORTAL_LOGGING_IN) {
+      reconnected = true;
+      EXPECT_LT(millis() - start, 50u);
+    }
+    if (_portal.getState() == ArduinoUTMWiFiPortal::PORTAL_AWAITING_LOGIN) {
+      usleep(1000);
+    } else {
+      HostShim::advanceMillis(250);
+    }
+  }
+  EXPECT_TRUE(reconnected);
+  EXPECT_TRUE(_portal.isOnline());
+  EXPECT_EQ(1u, _server.dropped());
+  EXPECT_EQ(2u, _server.logins());
+  EXPECT_EQ(0u, _portal.getReusedConnections());
+  EXPECT_EQ(ArduinoUTMWiFiPortal::LOGIN_OK, _portal.getLastLoginResult());
+}
+
+TEST_F(LoginTest, BeginLogsInOnRedirectWithoutPortalParameters) {
+  // Any HTTP answer other than 204 is the portal, whatever its Location
+  _server.setRedirectLocation("http://wifi.utm.my/login.html");
+  ArduinoUTMWiFiPortal::ProbeMode modes[] = { ArduinoUTMWiFiPortal::PROBE_HTTP, ArduinoUTMWiFiPortal::PROBE_RAW_HTTP,
+                                              ArduinoUTMWiFiPortal::PROBE_MULTI };
+  for (ArduinoUTMWiFiPortal::ProbeMode mode : modes) {
+    _server.setAuthorized(false);
+    uint32_t logins = _server.logins();
+    ArduinoUTMWiFiPortal portal("user", "secret");
+    portal.setProbeMode(mode);
+    EXPECT_TRUE(portal.begin(3000)) << "mode " << mode;
+    EXPECT_EQ(logins + 1, _server.logins()) << "mode " << mode;
+  }
+}
+
+TEST_F(LoginTest, BeginSkipsLoginWithoutAnAnswer) {
+  _portal.setProbeMode(ArduinoUTMWiFiPortal::PROBE_RAW_HTTP);
+  HostShim::setDnsFailing(true);
+  EXPECT_FALSE(_portal.begin(1000));
+  EXPECT_EQ(0u, _server.logins());
+  HostShim::setDnsFailing(false);
+}
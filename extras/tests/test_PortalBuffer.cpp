@@ -0,0 +1,104 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+#include <gtest/gtest.h>
+#include "PortalBuffer.h"
+
+TEST(PortalBuffer, AppendsAndTerminates) {
+  char text[32];
+  PortalBuffer buffer(text, sizeof(text));
+  buffer.append("user").append('=').append("abc", 2).appendNumber(407);
+  EXPECT_STREQ("user=ab407", text);
+  EXPECT_EQ(10u, buffer.length());
+  EXPECT_FALSE(buffer.overflowed());
+}
+
+TEST(PortalBuffer, DropsAppendsPastCapacity) {
+  char text[8];
+  PortalBuffer buffer(text, sizeof(text));
+  buffer.append("1234567");
+  EXPECT_FALSE(buffer.overflowed());
+  buffer.append("8");
+  EXPECT_TRUE(buffer.overflowed());
+  EXPECT_STREQ("1234567", text);
+  EXPECT_EQ(7u, buffer.length());
+}
+
+TEST(PortalBuffer, PercentEncodesFormValues) {
+  char text[64];
+  PortalBuffer buffer(text, sizeof(text));
+  buffer.appendEncoded("a&b c+d=e/~._-");
+  EXPECT_STREQ("a%26b%20c%2Bd%3De%2F~._-", text);
+}
+
+TEST(PortalBuffer, EncodesHighBytes) {
+  char text[16];
+  PortalBuffer buffer(text, sizeof(text));
+  buffer.appendEncoded("\xC3\xA9");
+  EXPECT_STREQ("%C3%A9", text);
+}
+
+TEST(PortalBuffer, AppendsMacWithEncodedSeparators) {
+  char text[64];
+  PortalBuffer buffer(text, sizeof(text));
+  const uint8_t mac[6] = { 0x00, 0x1B, 0x2F, 0xAA, 0x0B, 0xCC };
+  buffer.appendMac(mac);
+  EXPECT_STREQ("00%3A1b%3A2f%3Aaa%3A0b%3Acc", text);
+}
+
+TEST(PortalBuffer, AppendsIPAndNumbers) {
+  char text[32];
+  PortalBuffer buffer(text, sizeof(text));
+  buffer.appendIP(IPAddress(10, 0, 255, 7)).append(' ').appendNumber(0);
+  EXPECT_STREQ("10.0.255.7 0", text);
+}
+
+TEST(PortalBuffer, TruncateAndClear) {
+  char text[16];
+  PortalBuffer buffer(text, sizeof(text));
+  buffer.append("username");
+  buffer.truncate(4);
+  EXPECT_STREQ("user", text);
+  buffer.truncate(99); // beyond capacity: ignored
+  EXPECT_EQ(4u, buffer.length());
+  buffer.clear();
+  EXPECT_STREQ("", text);
+  EXPECT_EQ(0u, buffer.length());
+}
+
+TEST(PortalBuffer, AppendsFlashText) {
+  static const char LINE[] PROGMEM = "Host: x\r\n";
+  char text[16];
+  PortalBuffer buffer(text, sizeof(text));
+  buffer.appendP(LINE);
+  EXPECT_STREQ("Host: x\r\n", text);
+  buffer.appendP(LINE);
+  EXPECT_TRUE(buffer.overflowed());
+}
+
+TEST(PortalBuffer, ContinuesAfterExistingText) {
+  char text[32] = "username=a&x";
+  PortalBuffer buffer(text, sizeof(text), 10);
+  EXPECT_EQ(10u, buffer.length());
+  EXPECT_STREQ("username=a", text);
+  buffer.append("&password=b");
+  EXPECT_STREQ("username=a&password=b", text);
+  EXPECT_FALSE(buffer.overflowed());
+}
+
+TEST(PortalBuffer, ContinuationPastCapacityStartsEmpty) {
+  char text[8] = "abc";
+  PortalBuffer buffer(text, sizeof(text), 8);
+  EXPECT_EQ(0u, buffer.length());
+  buffer.append("z");
+  EXPECT_STREQ("z", text);
+}
@@ -0,0 +1,121 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+#include <gtest/gtest.h>
+#include "PortalClassifier.h"
+
+static PortalClassifier::Verdict classify(const char* text) {
+  PortalClassifier classifier;
+  classifier.feed(text, strlen(text));
+  return classifier.verdict();
+}
+
+TEST(PortalClassifier, RecognisesMarkers) {
+  EXPECT_EQ(PortalClassifier::VERDICT_NONE, classify("<html>hello</html>"));
+  EXPECT_EQ(PortalClassifier::VERDICT_SUCCESS, classify("<h1>You are now logged in</h1>"));
+  EXPECT_EQ(PortalClassifier::VERDICT_ALREADY_LOGGED_IN, classify("You are ALREADY logged in"));
+  EXPECT_EQ(PortalClassifier::VERDICT_QUOTA_EXCEEDED, classify("Maximum number of devices reached"));
+  EXPECT_EQ(PortalClassifier::VERDICT_BAD_CREDENTIALS, classify("Invalid User name"));
+}
+
+TEST(PortalClassifier, IgnoresSingleWords) {
+  EXPECT_EQ(PortalClassifier::VERDICT_NONE, classify("Welcome! success"));
+  EXPECT_EQ(PortalClassifier::VERDICT_NONE, classify("Already have an account?"));
+  EXPECT_EQ(PortalClassifier::VERDICT_NONE, classify("Incorrect? Quota: 2 GB, not exceeded"));
+}
+
+TEST(PortalClassifier, TreatsPlusAsSpace) {
+  EXPECT_EQ(PortalClassifier::VERDICT_BAD_CREDENTIALS, classify("?msg=Authentication+Failed"));
+}
+
+TEST(PortalClassifier, StrongestMarkerWins) {
+  EXPECT_EQ(PortalClassifier::VERDICT_BAD_CREDENTIALS, classify("You are now logged in. Login failed."));
+  EXPECT_EQ(PortalClassifier::VERDICT_QUOTA_EXCEEDED, classify("quota exceeded, login succeeded"));
+}
+
+TEST(PortalClassifier, MatchesAcrossChunks) {
+  PortalClassifier classifier;
+  classifier.feed("...you are now lo", 17);
+  EXPECT_EQ(PortalClassifier::VERDICT_NONE, classifier.verdict());
+  classifier.feed("gged in...", 10);
+  EXPECT_EQ(PortalClassifier::VERDICT_SUCCESS, classifier.verdict());
+}
+
+TEST(PortalClassifier, RestartsOnFirstLetter) {
+  EXPECT_EQ(PortalClassifier::VERDICT_BAD_CREDENTIALS, classify("llogin failed"));
+}
+
+TEST(PortalClassifier, DecidedOnlyOnBadCredentials) {
+  PortalClassifier classifier;
+  classifier.feed("login succeeded", 15);
+  EXPECT_FALSE(classifier.decided());
+  classifier.feed("access-reject", 13);
+  EXPECT_TRUE(classifier.decided());
+  classifier.reset();
+  EXPECT_EQ(PortalClassifier::VERDICT_NONE, classifier.verdict());
+  EXPECT_FALSE(classifier.decided());
+}
+
+// SmartZone hotspotlogin answers, as the login reads them: the Location
+// header (if any), then the body
+
+static const char SZ_LOGIN_OK[] = R"(<html><head><title>UTMWiFi</title></head>
+<body><h2>Welcome to UTMWiFi</h2><p>Your device is connected. Enjoy!</p>
+<!--<?xml version="1.0" encoding="UTF-8"?>
+<WISPAccessGatewayParam xmlns:xsi="http://www.w3.org/2001/XMLSchema-instance">
+<AuthenticationReply><MessageType>120</MessageType><ResponseCode>50</ResponseCode>
+<LogoffURL>https://utm-vsz-new.utm.my:9998/SubscriberPortal/hotspotlogout</LogoffURL>
+</AuthenticationReply></WISPAccessGatewayParam>-->
+</body></html>)";
+
+static const char SZ_LOGIN_REJECT[] = R"(<html><body><p>Please try again.</p>
+<!--<?xml version="1.0" encoding="UTF-8"?>
+<WISPAccessGatewayParam xmlns:xsi="http://www.w3.org/2001/XMLSchema-instance">
+<AuthenticationReply><MessageType>120</MessageType><ResponseCode>100</ResponseCode>
+<ReplyMessage>Access-Reject</ReplyMessage></AuthenticationReply></WISPAccessGatewayParam>-->
+</body></html>)";
+
+// Bounced back to the portal's login page: nothing about this login
+static const char SZ_LOGIN_PAGE[] = R"(http://wifi.utm.my/?sip=utm-vsz-new.utm.my&mac=00%3A1b%3A2f%3Aaa%3Abb%3Acc&reason=Un-Auth-Captive&dn=utm-vsz-new.utm.my
+<html><head><title>Welcome to UTMWiFi</title>
+<script>$.ajax({ url: "/notice", success: function (data) { $("#notice").html(data); } });</script></head>
+<body><form method="post" action="https://utm-vsz-new.utm.my:9998/SubscriberPortal/hotspotlogin">
+<input name="username" placeholder="Matric or staff number"><input type="password" name="password">
+<button>Login</button></form>
+<p>Already registered your device? Incorrect password three times locks the account for 15 minutes.</p>
+<p>Each account has a data quota; exceeded quotas reset at midnight.</p>
+</body></html>)";
+
+static const char SZ_REDIRECT_FAIL[] = "http://wifi.utm.my/?sip=utm-vsz-new.utm.my&mac=00%3A1b%3A2f%3Aaa%3Abb%3Acc"
+                                       "&uip=10.0.0.2&reason=Auth_Fail&dn=utm-vsz-new.utm.my\n";
+
+static const char SZ_ALREADY[] = "<html><body><p>This device is already authorized on UTMWiFi.</p></body></html>";
+
+TEST(PortalClassifier, SmartZoneSuccessPage) {
+  EXPECT_EQ(PortalClassifier::VERDICT_SUCCESS, classify(SZ_LOGIN_OK));
+}
+
+TEST(PortalClassifier, SmartZoneRejectPage) {
+  EXPECT_EQ(PortalClassifier::VERDICT_BAD_CREDENTIALS, classify(SZ_LOGIN_REJECT));
+}
+
+TEST(PortalClassifier, SmartZoneLoginPageSaysNothing) {
+  EXPECT_EQ(PortalClassifier::VERDICT_NONE, classify(SZ_LOGIN_PAGE));
+}
+
+TEST(PortalClassifier, SmartZoneFailureRedirect) {
+  EXPECT_EQ(PortalClassifier::VERDICT_BAD_CREDENTIALS, classify(SZ_REDIRECT_FAIL));
+}
+
+TEST(PortalClassifier, SmartZoneAlreadyAuthorized) {
+  EXPECT_EQ(PortalClassifier::VERDICT_ALREADY_LOGGED_IN, classify(SZ_ALREADY));
+}
@@ -0,0 +1,48 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+#include <gtest/gtest.h>
+#include "PortalHistogram.h"
+
+TEST(PortalHistogram, BucketsByUpperBound) {
+  PortalHistogram histogram;
+  histogram.record(0);
+  histogram.record(10);   // inclusive bound
+  histogram.record(11);
+  histogram.record(5000);
+  histogram.record(5001);
+  EXPECT_EQ(2u, histogram.bucket(0));
+  EXPECT_EQ(1u, histogram.bucket(1));
+  EXPECT_EQ(1u, histogram.bucket(8));
+  EXPECT_EQ(1u, histogram.bucket(9));
+  EXPECT_EQ(0u, histogram.bucket(PortalHistogram::BUCKETS));
+  EXPECT_EQ(5u, histogram.count());
+}
+
+TEST(PortalHistogram, UpperBounds) {
+  EXPECT_EQ(10u, PortalHistogram::upperBound(0));
+  EXPECT_EQ(5000u, PortalHistogram::upperBound(8));
+  EXPECT_EQ(0u, PortalHistogram::upperBound(9));
+}
+
+TEST(PortalHistogram, MeanMaxAndReset) {
+  PortalHistogram histogram;
+  EXPECT_EQ(0u, histogram.meanMs());
+  histogram.record(100);
+  histogram.record(300);
+  EXPECT_EQ(200u, histogram.meanMs());
+  EXPECT_EQ(300u, histogram.maxMs());
+  histogram.reset();
+  EXPECT_EQ(0u, histogram.count());
+  EXPECT_EQ(0u, histogram.maxMs());
+  EXPECT_EQ(0u, histogram.bucket(4));
+}
@@ -0,0 +1,91 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+#include <gtest/gtest.h>
+#include "PortalRedirect.h"
+
+static const char LOCATION[] =
+  "https://wifi.utm.my/?sip=utm-vsz-new.utm.my&mac=00:1b:2f:aa:bb:cc"
+  "&client_mac=24-0a-c4-12-34-56&uip=10.0.0.2&dn=utm-vsz-new.utm.my"
+  "&url=http%3A%2F%2Fwww.msftconnecttest.com%2Fredirect";
+
+TEST(PortalRedirect, ParsesSmartZoneRedirect) {
+  PortalRedirect redirect;
+  redirect.parse(LOCATION);
+  ASSERT_TRUE(redirect.valid());
+  EXPECT_STREQ("utm-vsz-new.utm.my", redirect.sip());
+  EXPECT_STREQ("utm-vsz-new.utm.my", redirect.dn());
+  EXPECT_STREQ("http%3A%2F%2Fwww.msftconnecttest.com%2Fredirect", redirect.url());
+  ASSERT_TRUE(redirect.hasApMac());
+  const uint8_t expectedMac[6] = { 0x00, 0x1b, 0x2f, 0xaa, 0xbb, 0xcc };
+  EXPECT_EQ(0, memcmp(expectedMac, redirect.apMac(), 6));
+  ASSERT_TRUE(redirect.hasClientIP());
+  EXPECT_EQ(IPAddress(10, 0, 0, 2), redirect.clientIP());
+}
+
+TEST(PortalRedirect, StreamingMatchesParse) {
+  PortalRedirect redirect;
+  for (const char* p = LOCATION; *p != '\0'; p++) {
+    redirect.feed(*p);
+  }
+  redirect.finish();
+  EXPECT_TRUE(redirect.valid());
+  EXPECT_STREQ("utm-vsz-new.utm.my", redirect.sip());
+}
+
+TEST(PortalRedirect, AcceptsEncodedAndBareMacs) {
+  PortalRedirect redirect;
+  redirect.parse("/?sip=x&mac=00%3A1B%3A2F%3AAA%3ABB%3ACC");
+  ASSERT_TRUE(redirect.hasApMac());
+  EXPECT_EQ(0xcc, redirect.apMac()[5]);
+
+  redirect.clear();
+  redirect.parse("/?sip=x&mac=001b2faabbcd");
+  ASSERT_TRUE(redirect.hasApMac());
+  EXPECT_EQ(0xcd, redirect.apMac()[5]);
+
+  redirect.clear();
+  redirect.parse("/?sip=x&mac=00:1b:2f");
+  EXPECT_FALSE(redirect.hasApMac());
+}
+
+TEST(PortalRedirect, RejectsBadClientIP) {
+  PortalRedirect redirect;
+  redirect.parse("/?sip=x&uip=10.0.0.256");
+  EXPECT_FALSE(redirect.hasClientIP());
+  redirect.clear();
+  redirect.parse("/?sip=x&uip=10.0.0");
+  EXPECT_FALSE(redirect.hasClientIP());
+}
+
+TEST(PortalRedirect, DropsTruncatedValues) {
+  std::string location = "/?url=" + std::string(300, 'a') + "&sip=portal";
+  PortalRedirect redirect;
+  redirect.parse(location.c_str());
+  EXPECT_STREQ("", redirect.url());
+  EXPECT_STREQ("portal", redirect.sip());
+}
+
+TEST(PortalRedirect, NoQueryIsNotARedirect) {
+  PortalRedirect redirect;
+  redirect.parse("https://wifi.utm.my/login");
+  EXPECT_FALSE(redirect.valid());
+  redirect.parse("/?sip=");
+  EXPECT_FALSE(redirect.valid());
+}
+
+TEST(PortalRedirect, StopsAtFragment) {
+  PortalRedirect redirect;
+  redirect.parse("/?sip=a#dn=b");
+  EXPECT_STREQ("a", redirect.sip());
+  EXPECT_STREQ("", redirect.dn());
+}
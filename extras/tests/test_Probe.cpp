@@ -0,0 +1,176 @@
+// // This example demonstrates a simple usage of the ArduinoUTMWiFiPortal library to connect
+// // to the UTM WiFi captive portal and maintain the connection.
+//           .d888                       888 d8b                                 d8b 
+//          d88P"                        888 Y8P                                 Y8P 
+//          888                          888                                         
+//  8888b.  888888 8888b.  88888b.   .d88888 888  8888b.  88888888 88888b.d88b.  888 
+//     "88b 888       "88b 888 "88b d88" 888 888     "88b    d88P  888 "888 "88b 888 
+// .d888888 888   .d888888 888  888 888  888 888 .d888888   d88P   888  888  888 888 
+// 888  888 888   888  888 888  888 Y88b 888 888 888  888  d88P    888  888  888 888 
+// "Y888888 888   "Y888888 888  888  "Y88888 888 "Y888888 88888888 888  888  888 888 
+// Created by Afandi Azmi, 2025
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <thread>
+#include "ArduinoUTMWiFiPortal.h"
+#include "HostShim.h"
+#include "LoopbackPortal.h"
+
+// Connectivity probes against the loopback stand-in
+class ProbeTest : public ::testing::TestWithParam<ArduinoUTMWiFiPortal::ProbeMode> {
+  protected:
+    void SetUp() override {
+      HostShim::setStationConnected(true);
+      HostShim::setDnsFailing(false);
+      ASSERT_TRUE(_server.start());
+      _portal.setProbeCacheTtl(0);
+      _portal.setProbeMode(GetParam());
+    }
+
+    void TearDown() override {
+      _server.stop();
+    }
+
+    LoopbackPortal _server;
+    ArduinoUTMWiFiPortal _portal{"user", "secret"};
+};
+
+TEST_P(ProbeTest, OnlineWhenAuthorized) {
+  _server.setAuthorized(true);
+  EXPECT_TRUE(_portal.checkInternet());
+  EXPECT_TRUE(_portal.isOnline());
+  EXPECT_EQ(1u, _portal.getMetrics().probes);
+}
+
+TEST_P(ProbeTest, OfflineWithoutStation) {
+  _server.setAuthorized(true);
+  HostShim::setStationConnected(false);
+  EXPECT_FALSE(_portal.checkInternet());
+  EXPECT_FALSE(_portal.isOnline());
+  HostShim::setStationConnected(true);
+}
+
+INSTANTIATE_TEST_SUITE_P(AllModes, ProbeTest,
+  ::testing::Values(ArduinoUTMWiFiPortal::PROBE_HTTP, ArduinoUTMWiFiPortal::PROBE_RAW_HTTP,
+                    ArduinoUTMWiFiPortal::PROBE_TCP, ArduinoUTMWiFiPortal::PROBE_DNS,
+                    ArduinoUTMWiFiPortal::PROBE_MULTI));
+
+// The HTTP probes see the portal's redirect and report offline
+class RedirectTest : public ProbeTest {};
+
+TEST_P(RedirectTest, OfflineBehindPortal) {
+  _server.setAuthorized(false);
+  EXPECT_FALSE(_portal.checkInternet());
+  EXPECT_GE(_server.probes(), 1u);
+}
+
+INSTANTIATE_TEST_SUITE_P(HttpModes, RedirectTest,
+  ::testing::Values(ArduinoUTMWiFiPortal::PROBE_HTTP, ArduinoUTMWiFiPortal::PROBE_RAW_HTTP,
+                    ArduinoUTMWiFiPortal::PROBE_MULTI));
+
+TEST(ProbeCache, FreshResultIsReused) {
+  LoopbackPortal server;
+  ASSERT_TRUE(server.start());
+  server.setAuthorized(true);
+  ArduinoUTMWiFiPortal portal("user", "secret");
+  portal.setProbeMode(ArduinoUTMWiFiPortal::PROBE_RAW_HTTP);
+  EXPECT_TRUE(portal.checkInternet());
+  EXPECT_TRUE(portal.checkInternet());
+  EXPECT_EQ(1u, server.probes());
+  HostShim::advanceMillis(6000);
+  EXPECT_TRUE(portal.checkInternet());
+  EXPECT_EQ(2u, server.probes());
+}
+
+TEST(ProbeMulti, SlowLookupsStayWithinTimeout) {
+  LoopbackPortal server;
+  ASSERT_TRUE(server.start());
+  server.setAuthorized(true);
+  HostShim::setStationConnected(true);
+  HostShim::setDnsDelay(150);
+  ArduinoUTMWiFiPortal portal("user", "secret");
+  portal.setProbeMode(ArduinoUTMWiFiPortal::PROBE_MULTI);
+  portal.setProbeQuorum(3);
+  portal.setStepBudget(100000);
+
+  // Run probes until one starts; it must give up with the first lookup
+  unsigned long longest = 0;
+  for (int i = 0; i < 40 && portal.getMetrics().probes == 0; i++) {
+    unsigned long startTime = millis();
+    portal.keepConnected();
+    unsigned long elapsed = millis() - startTime;
+    longest = elapsed > longest ? elapsed : longest;
+    HostShim::advanceMillis(250);
+  }
+  HostShim::setDnsDelay(0);
+  EXPECT_EQ(1u, portal.getMetrics().probes);
+  EXPECT_LT(longest, 300u);
+}
+
+TEST(ProbeCache, WaitForOtherProbeIsBounded) {
+  LoopbackPortal server;
+  ASSERT_TRUE(server.start());
+  server.setAuthorized(true);
+  server.setProbeDelay(400);
+  HostShim::setStationConnected(true);
+  ArduinoUTMWiFiPortal portal("user", "secret");
+  portal.setProbeMode(ArduinoUTMWiFiPortal::PROBE_RAW_HTTP);
+  portal.setProbeCacheTtl(0);
+  portal.setStepBudget(50000);
+  for (int i = 0; i < 40 && portal.getState() != ArduinoUTMWiFiPortal::PORTAL_PROBING; i++) {
+    portal.keepConnected();
+    HostShim::advanceMillis(250);
+  }
+  ASSERT_EQ(ArduinoUTMWiFiPortal::PORTAL_PROBING, portal.getState());
+
+  // Another task's checkInternet() is probing: the step waits out its own
+  // budget, then stays in PROBING without a verdict
+  std::thread other([&portal] { portal.checkInternet(); });
+  for (int i = 0; i < 1000 && server.probes() == 0; i++) {
+    usleep(1000);
+  }
+  unsigned long startTime = millis();
+  portal.keepConnected();
+  EXPECT_LT(millis() - startTime, 200u);
+  EXPECT_EQ(ArduinoUTMWiFiPortal::PORTAL_PROBING, portal.getState());
+  other.join();
+  EXPECT_EQ(1u, server.probes());
+}
+
+TEST(ProbeMulti, LooksUpTargetsThroughTheCache) {
+  LoopbackPortal server;
+  ASSERT_TRUE(server.start());
+  server.setAuthorized(true);
+  HostShim::setStationConnected(true);
+  ArduinoUTMWiFiPortal portal("user", "secret");
+  portal.setProbeMode(ArduinoUTMWiFiPortal::PROBE_MULTI);
+  portal.setProbeCacheTtl(0);
+
+  // One lookup per keepConnected() step, then the probe
+  for (int i = 0; i < 40 && portal.getMetrics().probes == 0; i++) {
+    portal.keepConnected();
+    HostShim::advanceMillis(250);
+  }
+  EXPECT_EQ(1u, portal.getMetrics().probes);
+  EXPECT_EQ(3u, portal.getMetrics().dnsMs.count());
+  EXPECT_TRUE(portal.isOnline());
+
+  // Within the DNS cache TTL the next probe looks nothing up
+  EXPECT_TRUE(portal.checkInternet());
+  EXPECT_EQ(3u, portal.getMetrics().dnsMs.count());
+  EXPECT_EQ(3u, portal.getMetrics().dnsCacheHits);
+}
+
+TEST(ProbeMulti, TargetsWithoutAddressSitOut) {
+  LoopbackPortal server;
+  ASSERT_TRUE(server.start());
+  server.setAuthorized(true);
+  HostShim::setStationConnected(true);
+  HostShim::setDnsFailing(true);
+  ArduinoUTMWiFiPortal portal("user", "secret");
+  portal.setProbeMode(ArduinoUTMWiFiPortal::PROBE_MULTI);
+  EXPECT_FALSE(portal.checkInternet());
+  EXPECT_EQ(0u, server.probes());
+  HostShim::setDnsFailing(false);
+}